@@ -0,0 +1,124 @@
+#!/bin/sh
+# generate a synthetic LV2_PATH for the benchmark
+#
+# usage: gen_corpus.sh DIR [BUNDLES] [PLUGINS] [PORTS] [PRESETS]
+#
+#   DIR      the LV2 directory to create
+#   BUNDLES  number of plugin bundles (default 100)
+#   PLUGINS  plugins per bundle (default 10)
+#   PORTS    ports per plugin (default 8)
+#   PRESETS  presets per plugin (default 4)
+#
+# besides the plugin bundles a small lv2core bundle provides a plugin
+# class hierarchy, so nothing of the host install is needed
+
+set -e
+
+DIR=$1
+BUNDLES=${2:-100}
+PLUGINS=${3:-10}
+PORTS=${4:-8}
+PRESETS=${5:-4}
+
+if [ -z "$DIR" ]; then
+    echo "usage: $0 DIR [BUNDLES] [PLUGINS] [PORTS] [PRESETS]" >&2
+    exit 1
+fi
+
+mkdir -p "$DIR"
+
+awk -v dir="$DIR" -v bundles="$BUNDLES" -v plugins="$PLUGINS" \
+    -v ports="$PORTS" -v presets="$PRESETS" '
+function prefixes(f) {
+    print "@prefix atom: <http://lv2plug.in/ns/ext/atom#> ." > f
+    print "@prefix doap: <http://usefulinc.com/ns/doap#> ." > f
+    print "@prefix foaf: <http://xmlns.com/foaf/0.1/> ." > f
+    print "@prefix lv2:  <http://lv2plug.in/ns/lv2core#> ." > f
+    print "@prefix midi: <http://lv2plug.in/ns/ext/midi#> ." > f
+    print "@prefix pset: <http://lv2plug.in/ns/ext/presets#> ." > f
+    print "@prefix rdfs: <http://www.w3.org/2000/01/rdf-schema#> ." > f
+    print "" > f
+}
+
+function port(f, i, last,    sep) {
+    sep = last ? " ." : " ,"
+    if (i < 2) {
+        printf "        [ a lv2:AudioPort, lv2:InputPort ; lv2:index %d ; lv2:symbol \"in%d\" ; lv2:name \"In %d\" ]%s\n", i, i, i, sep > f
+    } else if (i < 4) {
+        printf "        [ a lv2:AudioPort, lv2:OutputPort ; lv2:index %d ; lv2:symbol \"out%d\" ; lv2:name \"Out %d\" ]%s\n", i, i, i, sep > f
+    } else if (i == 4) {
+        printf "        [ a atom:AtomPort, lv2:InputPort ; atom:bufferType atom:Sequence ; atom:supports midi:MidiEvent ;\n" > f
+        printf "          lv2:index %d ; lv2:symbol \"midi_in\" ; lv2:name \"MIDI In\" ]%s\n", i, sep > f
+    } else {
+        printf "        [ a lv2:ControlPort, lv2:InputPort ; lv2:index %d ; lv2:symbol \"ctl%d\" ; lv2:name \"Control %d\" ;\n", i, i, i > f
+        printf "          lv2:default 0.5 ; lv2:minimum 0.0 ; lv2:maximum 1.0 ]%s\n", sep > f
+    }
+}
+
+BEGIN {
+    # lv2core: the class labels and parents lilv reads for the class combo
+    n = split("Delay:Plugin Reverb:Delay Filter:Plugin Lowpass:Filter EQ:Filter " \
+              "Dynamics:Plugin Compressor:Dynamics Generator:Plugin " \
+              "Instrument:Generator Utility:Plugin Analyser:Utility", cls, " ")
+    core = dir "/lv2core.lv2"
+    system("mkdir -p \"" core "\"")
+    f = core "/manifest.ttl"
+    prefixes(f)
+    print "<http://lv2plug.in/ns/lv2core> a lv2:Specification ;" > f
+    print "    rdfs:seeAlso <lv2core.ttl> ." > f
+    close(f)
+    f = core "/lv2core.ttl"
+    prefixes(f)
+    print "lv2:Plugin a rdfs:Class ; rdfs:label \"Plugin\" ." > f
+    for (c = 1; c <= n; c++) {
+        split(cls[c], kv, ":")
+        class[c] = kv[1]
+        printf "lv2:%sPlugin a rdfs:Class ; rdfs:subClassOf lv2:%s ; rdfs:label \"%s\" .\n", \
+               kv[1], kv[2] == "Plugin" ? "Plugin" : kv[2] "Plugin", kv[1] > f
+    }
+    close(f)
+
+    nw = split("Warm Tube Vintage Stereo Mono Analog Digital Crystal Deep Wide " \
+               "Smooth Dirty Classic Modern Tiny Huge Space Room Plate Spring", word, " ")
+    for (b = 0; b < bundles; b++) {
+        bundle = sprintf("%s/bench%05d.lv2", dir, b)
+        system("mkdir -p \"" bundle "\"")
+        m = bundle "/manifest.ttl"
+        t = bundle "/plugins.ttl"
+        s = bundle "/presets.ttl"
+        prefixes(m)
+        prefixes(t)
+        prefixes(s)
+        for (p = 0; p < plugins; p++) {
+            uri = sprintf("urn:jalv-select-bench:b%d:p%d", b, p)
+            c = (b + p) % n + 1
+            printf "<%s> a lv2:Plugin ;\n    lv2:binary <bench.so> ;\n    rdfs:seeAlso <plugins.ttl> .\n\n", uri > m
+            printf "<%s> a lv2:Plugin, lv2:%sPlugin ;\n", uri, class[c] > t
+            printf "    doap:name \"%s %s %s %d-%d\" ;\n", word[(b * 7 + p * 3) % nw + 1], \
+                   word[(b + p * 11) % nw + 1], class[c], b, p > t
+            printf "    doap:maintainer [ foaf:name \"Bench Author %d\" ] ;\n", b % 50 > t
+            printf "    lv2:binary <bench.so>" > t
+            if (ports > 0) {
+                printf " ;\n    lv2:port\n" > t
+                for (i = 0; i < ports; i++) port(t, i, i == ports - 1)
+            } else {
+                printf " .\n" > t
+            }
+            print "" > t
+            for (k = 0; k < presets; k++) {
+                printf "<%s:preset%d> a pset:Preset ;\n    lv2:appliesTo <%s> ;\n    rdfs:seeAlso <presets.ttl> .\n\n", \
+                       uri, k, uri > m
+                printf "<%s:preset%d> a pset:Preset ;\n    lv2:appliesTo <%s> ;\n    rdfs:label \"Preset %d\"", \
+                       uri, k, uri, k > s
+                if (ports > 5) {
+                    printf " ;\n    lv2:port [ lv2:symbol \"ctl5\" ; pset:value %.2f ] .\n\n", k / presets > s
+                } else {
+                    printf " .\n\n" > s
+                }
+            }
+        }
+        close(m)
+        close(t)
+        close(s)
+    }
+}'
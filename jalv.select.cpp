@@ -37,202 +37,3190 @@ inline std::string to_string(const T& t) {
     return ss.str();
 }
 
+// export JALV_SELECT_TIMING=1 to get the startup timings on stderr
+static void log_timing(const char* what, gint64 since) {
+    static bool enabled = getenv("JALV_SELECT_TIMING") != NULL;
+    if (!enabled) return;
+    fprintf(stderr, "jalv.select: %s %.3f ms\n", what,
+            (g_get_monotonic_time() - since) / 1000.0);
+}
+
+static std::string json_string(const std::string& s) {
+    std::string r = "\"";
+    for (std::string::const_iterator it = s.begin(); it != s.end(); ++it) {
+        unsigned char ch = *it;
+        if (ch == '"' || ch == '\\') {
+            r += '\\';
+            r += ch;
+        } else if (ch < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", ch);
+            r += esc;
+        } else {
+            r += ch;
+        }
+    }
+    return r + "\"";
+}
+
+
+///*** ----------- Class Trace functions ----------- ***///
+
+std::atomic<bool> Trace::enabled(false);
+std::mutex Trace::mutex;
+std::string Trace::file;
+gint64 Trace::origin = 0;
+std::vector<std::string> Trace::events;
+
+// --trace=FILE or export JALV_SELECT_TRACE=FILE, load FILE in chrome://tracing
+void Trace::open(const std::string& path) {
+    if (path.empty() || is_enabled()) return;
+    file = path;
+    origin = g_get_monotonic_time();
+    events.reserve(4096);
+    enabled = true;
+    atexit(write);
+}
+
+void Trace::complete(const char* name, gint64 start, const char* detail) {
+    if (!is_enabled()) return;
+    static std::atomic<int32_t> next_tid(1);
+    static thread_local int32_t tid = next_tid++;
+    gint64 now = g_get_monotonic_time();
+    char buf[128];
+    snprintf(buf, sizeof(buf),
+        "{\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"dur\":%lld,\"name\":",
+        (int)getpid(), tid, (long long)(start - origin), (long long)(now - start));
+    std::string ev = buf;
+    ev += json_string(name);
+    if (detail) {
+        ev += ",\"args\":{\"detail\":";
+        ev += json_string(detail);
+        ev += "}";
+    }
+    ev += "}";
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(ev);
+}
+
+void Trace::write() {
+    std::lock_guard<std::mutex> lock(mutex);
+    enabled = false;
+    FILE* fp = fopen(file.c_str(), "w");
+    if (!fp) {
+        fprintf(stderr, _("jalv.select: can't write trace %s\n"), file.c_str());
+        return;
+    }
+    fputs("{\"traceEvents\":[\n", fp);
+    for (std::vector<std::string>::iterator it = events.begin(); it != events.end(); ++it) {
+        fputs(it->c_str(), fp);
+        fputs(it + 1 != events.end() ? ",\n" : "\n", fp);
+    }
+    fputs("],\"displayTimeUnit\":\"ms\"}\n", fp);
+    fclose(fp);
+}
+
+
+///*** ----------- Class Options functions ----------- ***///
+
+Options::Options() :
+    o_group("",""),
+    hidden(false),
+    version(false),
+    w_high(0),
+    list(false),
+    json(false),
+    bench(0),
+    jobs(0),
+    catalog_helper(false) {
+        opt_hide.set_short_name('s');
+        opt_hide.set_long_name("systray");
+        opt_hide.set_description(_("start minimized in systray"));
+
+        opt_size.set_short_name('H');
+        opt_size.set_long_name("high");
+        opt_size.set_description(_("start with given high in pixel"));
+        opt_size.set_arg_description("HIGH");
+
+        opt_version.set_short_name('v');
+        opt_version.set_long_name("version");
+        opt_version.set_description(_("print version string and exit"));
+
+        opt_list.set_short_name('l');
+        opt_list.set_long_name("list");
+        opt_list.set_description(_("print the installed plugins and exit"));
+
+        opt_presets.set_short_name('p');
+        opt_presets.set_long_name("presets");
+        opt_presets.set_description(_("print the presets of a plugin and exit"));
+        opt_presets.set_arg_description("URI");
+
+        opt_filter.set_short_name('f');
+        opt_filter.set_long_name("filter");
+        opt_filter.set_description(_("print the plugins matching a search and exit"));
+        opt_filter.set_arg_description("TEXT");
+
+        opt_json.set_short_name('j');
+        opt_json.set_long_name("json");
+        opt_json.set_description(_("print JSON instead of tab separated values"));
+
+        o_group.add_entry(opt_hide, hidden);
+        o_group.add_entry(opt_size, w_high);
+        o_group.add_entry(opt_version, version);
+        o_group.add_entry(opt_list, list);
+        o_group.add_entry(opt_presets, presets);
+        o_group.add_entry(opt_filter, filter);
+        opt_bench.set_long_name("bench");
+        opt_bench.set_description(_("time the catalog, search and view code RUNS times and exit"));
+        opt_bench.set_arg_description("RUNS");
+
+        opt_jobs.set_long_name("jobs");
+        opt_jobs.set_description(_("parse the plugins in N processes, 0 picks one per core"));
+        opt_jobs.set_arg_description("N");
+
+        // the mode the parsing processes run in
+        opt_helper.set_long_name("catalog-helper");
+        opt_helper.set_flags(Glib::OptionEntry::FLAG_HIDDEN);
+
+        opt_trace.set_long_name("trace");
+        opt_trace.set_description(_("write a Chrome trace of the startup and the UI to FILE"));
+        opt_trace.set_arg_description("FILE");
+
+        opt_launch.set_long_name("launch");
+        opt_launch.set_description(_("run a plugin with the selected interpreter"));
+        opt_launch.set_arg_description("URI");
+
+        opt_hotkey.set_long_name("hotkey");
+        opt_hotkey.set_description(_("global hotkey to show or hide the window, default <Shift>Escape"));
+        opt_hotkey.set_arg_description("ACCEL");
+
+        o_group.add_entry(opt_json, json);
+        o_group.add_entry(opt_bench, bench);
+        o_group.add_entry(opt_jobs, jobs);
+        o_group.add_entry(opt_helper, catalog_helper);
+        o_group.add_entry_filename(opt_trace, trace);
+        o_group.add_entry(opt_launch, launch);
+        o_group.add_entry(opt_hotkey, hotkey);
+        set_main_group(o_group);
+        // parsed before GTK, which takes its own options later
+        set_ignore_unknown_options(true);
+    }
+
+Options::~Options() {}
+
+void Options::show_version() {
+    fprintf(stderr, "jalv.select version \033[1;32m %s \n \033[0m" 
+      "    Public Domain @ 2019 by Hermman Meyer\n", VERSION );
+}
+
+
+///*** ----------- Class Launcher functions ----------- ***///
+
+extern char **environ;
+
+// finished children are kept for the record, up to this many
+#define LAUNCHER_HISTORY 64
+
+Launcher::Launcher() {
+}
+
+Launcher::~Launcher() {
+}
+
+// the interpreter entry may carry options ("jalv -s"), it's split like a
+// shell would do it but never run through one
+pid_t Launcher::launch(const Glib::ustring& interpret, const std::vector<std::string>& args,
+                       const std::string& uri) {
+    std::vector<std::string> argv;
+    try {
+        argv = Glib::shell_parse_argv(interpret);
+    } catch (Glib::ShellError& e) {
+        fprintf(stderr, "jalv.select: %s\n", e.what().c_str());
+        return -1;
+    }
+    argv.insert(argv.end(), args.begin(), args.end());
+    std::vector<char*> cargv;
+    std::string command;
+    for (std::vector<std::string>::iterator it = argv.begin(); it != argv.end(); ++it) {
+        cargv.push_back(const_cast<char*>(it->c_str()));
+        if (!command.empty()) command += " ";
+        command += *it;
+    }
+    cargv.push_back(NULL);
+
+    TraceSpan span("launch", command);
+    pid_t pid;
+    gint64 start = g_get_monotonic_time();
+    // posix_spawn returns once the child has exec'd (or failed to)
+    int err = posix_spawnp(&pid, cargv[0], NULL, NULL, &cargv[0], environ);
+    gint64 spawn_time = g_get_monotonic_time() - start;
+    if (err) {
+        fprintf(stderr, "jalv.select: can't start %s: %s\n", cargv[0], strerror(err));
+        return -1;
+    }
+    log_timing("spawn", start);
+
+    size_t finished = children.size() - running();
+    for (std::vector<ChildProcess>::iterator it = children.begin();
+                 finished >= LAUNCHER_HISTORY && it != children.end();) {
+        if (it->running) {
+            ++it;
+        } else {
+            it = children.erase(it);
+            finished--;
+        }
+    }
+    ChildProcess child;
+    child.pid = pid;
+    child.uri = uri;
+    child.command = command;
+    child.start = g_get_real_time();
+    child.spawn_time = spawn_time;
+    child.run_time = 0;
+    child.status = 0;
+    child.running = true;
+    children.push_back(child);
+    Glib::signal_child_watch().connect(
+      sigc::mem_fun(*this, &Launcher::on_child_exit), pid);
+    on_launch(uri);
+    return pid;
+}
+
+void Launcher::on_child_exit(GPid pid, int status) {
+    for (std::vector<ChildProcess>::iterator it = children.begin(); it != children.end(); ++it) {
+        if (it->pid != pid || !it->running) continue;
+        it->running = false;
+        it->status = status;
+        it->run_time = g_get_real_time() - it->start;
+        if (WIFEXITED(status) && WEXITSTATUS(status)) {
+            fprintf(stderr, "jalv.select: %s exited with status %i\n",
+                    it->command.c_str(), WEXITSTATUS(status));
+        } else if (WIFSIGNALED(status)) {
+            fprintf(stderr, "jalv.select: %s killed by signal %i\n",
+                    it->command.c_str(), WTERMSIG(status));
+        }
+        break;
+    }
+    g_spawn_close_pid(pid);
+}
+
+size_t Launcher::running() const {
+    size_t n = 0;
+    for (std::vector<ChildProcess>::const_iterator it = children.begin(); it != children.end(); ++it) {
+        if (it->running) n++;
+    }
+    return n;
+}
+
+
+///*** ----------- Class PresetList functions ----------- ***///
+
+PresetList::PresetList() {
+    presetStore = Gtk::ListStore::create(psets);
+    presetStore->set_sort_column(psets.col_label, Gtk::SORT_ASCENDING); 
+}
+
+PresetList::~PresetList() { 
+}
+
+void PresetList::on_preset_selected(Gtk::Menu *presetMenu, Glib::ustring id, Gtk::TreeModel::iterator iter) {
+    Gtk::TreeModel::Row row = *iter;
+    Gtk::TreeModel::iterator it = selection->get_selected();
+    if(iter) selection->unselect(*it);
+    std::vector<std::string> args;
+    args.push_back("-p");
+    args.push_back(row.get_value(psets.col_uri));
+    args.push_back(id);
+    launcher.launch(interpret, args, id);
+    presetStore->clear();
+    delete presetMenu;
+}
+
+void PresetList::on_preset_default(Gtk::Menu *presetMenu, Glib::ustring id) {
+    Gtk::TreeModel::iterator iter = selection->get_selected();
+    if(iter) selection->unselect(*iter);
+    launcher.launch(interpret, std::vector<std::string>(1, id), id);
+    presetStore->clear();
+    delete presetMenu;
+}
+
+void PresetList::on_preset_key(GdkEventKey *ev,Gtk::Menu *presetMenu) {
+    if (ev->keyval == 0xff1b) { // GDK_KEY_Escape
+        presetStore->clear();
+        delete presetMenu;
+    }
+}
+
+void PresetList::create_preset_menu(Glib::ustring id) {
+    TraceSpan span("menu popup", id);
+    Gtk::MenuItem* item;
+    Gtk::Menu *presetMenu = Gtk::manage(new Gtk::Menu());
+    presetMenu->signal_key_release_event().connect_notify(
+          sigc::bind(sigc::mem_fun(
+          *this, &PresetList::on_preset_key),presetMenu));
+    item = Gtk::manage(new Gtk::MenuItem(_("Default"), true));
+    item->signal_activate().connect_notify(
+          sigc::bind(sigc::bind(sigc::mem_fun(
+          *this, &PresetList::on_preset_default),id),presetMenu));
+    presetMenu->append(*item);
+    if (presetStore->children().end() != presetStore->children().begin()) {
+        Gtk::SeparatorMenuItem *hline = Gtk::manage(new Gtk::SeparatorMenuItem());
+        presetMenu->append(*hline);
+        for (Gtk::TreeModel::iterator i = presetStore->children().begin();
+                                  i != presetStore->children().end(); i++) {
+            Gtk::TreeModel::Row row = *i; 
+            item = Gtk::manage(new Gtk::MenuItem(row[psets.col_label], true));
+            item->signal_activate().connect(
+              sigc::bind(sigc::bind(sigc::bind(sigc::mem_fun(
+              *this, &PresetList::on_preset_selected),i),id),presetMenu));
+            presetMenu->append(*item);
+            
+        }
+    }
+    presetMenu->show_all();
+    presetMenu->popup(0,gtk_get_current_event_time());
+}
+
+void PresetList::create_preset_list(Glib::ustring id, const std::vector<PresetEntry>* presets) {
+    TraceSpan span("preset list", id);
+    presetStore->clear();
+    if (presets) {
+        for (std::vector<PresetEntry>::const_iterator it = presets->begin();
+                                          it != presets->end(); ++it) {
+            row = *(presetStore->append());
+            row[psets.col_label] = it->label;
+            row[psets.col_uri] = it->uri;
+        }
+    }
+    create_preset_menu(id);
+}
+
+
+///*** ----------- Class PresetIndex functions ----------- ***///
+
+static bool preset_less(const PresetEntry& a, const PresetEntry& b) {
+    return a.label < b.label;
+}
+
+// the document a preset comes from, the file its manifest names with
+// rdfs:seeAlso or else the preset itself
+static std::string preset_doc(LilvWorld* world, const LilvNode* preset) {
+    LilvNode* rdfs_seeAlso = lilv_new_uri(world, LILV_NS_RDFS "seeAlso");
+    LilvNode* doc = lilv_world_get(world, preset, rdfs_seeAlso, NULL);
+    std::string d = doc && lilv_node_is_uri(doc) ? lilv_node_as_uri(doc) : lilv_node_as_uri(preset);
+    if (doc) lilv_node_free(doc);
+    lilv_node_free(rdfs_seeAlso);
+    return d;
+}
+
+// loads the preset resource for its label
+static bool preset_entry(LilvWorld* world, const LilvNode* preset,
+                         const LilvNode* rdfs_label, PresetEntry* e) {
+    lilv_world_load_resource(world, preset);
+    LilvNode* label = lilv_world_get(world, preset, rdfs_label, NULL);
+    if (!label) {
+        fprintf(stderr, _("Preset <%s> has no rdfs:label\n"),
+                lilv_node_as_string(preset));
+        return false;
+    }
+    e->uri = lilv_node_as_uri(preset);
+    e->label = lilv_node_as_string(label);
+    e->doc = preset_doc(world, preset);
+    lilv_node_free(label);
+    return true;
+}
+
+// runs in the loading thread, loads every preset resource of the world once
+void PresetIndex::build(LilvWorld* world, const std::atomic<bool>& cancelled) {
+    presets.clear();
+    LilvNode* pset_Preset = lilv_new_uri(world, LV2_PRESETS__Preset);
+    LilvNode* rdfs_label = lilv_new_uri(world, LILV_NS_RDFS "label");
+    const LilvPlugins* lv2_plugins = lilv_world_get_all_plugins(world);
+    LILV_FOREACH(plugins, it, lv2_plugins) {
+        if (cancelled) break;
+        add_plugin(world, lilv_plugins_get(lv2_plugins, it), pset_Preset, rdfs_label);
+    }
+    lilv_node_free(rdfs_label);
+    lilv_node_free(pset_Preset);
+}
+
+void PresetIndex::add_plugin(LilvWorld* world, const LilvPlugin* plug,
+                             const LilvNode* pset_Preset, const LilvNode* rdfs_label) {
+    LilvNodes* related = lilv_plugin_get_related(plug, pset_Preset);
+    if (!related) return;
+    std::vector<PresetEntry> entries;
+    LILV_FOREACH(nodes, i, related) {
+        PresetEntry e;
+        if (preset_entry(world, lilv_nodes_get(related, i), rdfs_label, &e)) {
+            entries.push_back(e);
+        }
+    }
+    lilv_nodes_free(related);
+    if (entries.empty()) return;
+    sort(entries.begin(), entries.end(), preset_less);
+    presets[lilv_node_as_uri(lilv_plugin_get_uri(plug))].swap(entries);
+}
+
+// indexes a single plugin, false when the world doesn't know it
+bool PresetIndex::build_plugin(LilvWorld* world, const std::string& uri) {
+    LilvNode* nd = lilv_new_uri(world, uri.c_str());
+    const LilvPlugin* plug = lilv_plugins_get_by_uri(lilv_world_get_all_plugins(world), nd);
+    lilv_node_free(nd);
+    if (!plug) return false;
+    LilvNode* pset_Preset = lilv_new_uri(world, LV2_PRESETS__Preset);
+    LilvNode* rdfs_label = lilv_new_uri(world, LILV_NS_RDFS "label");
+    add_plugin(world, plug, pset_Preset, rdfs_label);
+    lilv_node_free(rdfs_label);
+    lilv_node_free(pset_Preset);
+    return true;
+}
+
+static bool in_bundles(const std::string& uri, const std::vector<std::string>& bundle_uris) {
+    for (std::vector<std::string>::const_iterator it = bundle_uris.begin();
+                                      it != bundle_uris.end(); ++it) {
+        if (uri.compare(0, it->size(), *it) == 0) return true;
+    }
+    return false;
+}
+
+// only the plugins which changed or have a preset from a document in one
+// of the reloaded bundles, before or after the reload, are indexed again
+void PresetIndex::update(LilvWorld* world, const std::vector<std::string>& bundle_uris,
+                         const std::set<std::string>& changed) {
+    std::set<std::string> plugs(changed);
+    for (std::unordered_map<std::string, std::vector<PresetEntry> >::iterator it = presets.begin();
+                                                                 it != presets.end(); ++it) {
+        for (std::vector<PresetEntry>::iterator e = it->second.begin(); e != it->second.end(); ++e) {
+            if (in_bundles(e->doc, bundle_uris)) {
+                plugs.insert(it->first);
+                break;
+            }
+        }
+    }
+    // the manifests name every preset and its file, so this loads no
+    // plugin data, presets with http URIs are found by their file
+    LilvNode* pset_Preset = lilv_new_uri(world, LV2_PRESETS__Preset);
+    LilvNode* rdf_type = lilv_new_uri(world, LILV_NS_RDF "type");
+    LilvNode* lv2_appliesTo = lilv_new_uri(world, LV2_CORE__appliesTo);
+    LilvNodes* all = lilv_world_find_nodes(world, NULL, rdf_type, pset_Preset);
+    LILV_FOREACH(nodes, i, all) {
+        const LilvNode* preset = lilv_nodes_get(all, i);
+        if (!in_bundles(preset_doc(world, preset), bundle_uris)) continue;
+        LilvNodes* applies = lilv_world_find_nodes(world, preset, lv2_appliesTo, NULL);
+        LILV_FOREACH(nodes, j, applies) {
+            const LilvNode* plug = lilv_nodes_get(applies, j);
+            if (lilv_node_is_uri(plug)) plugs.insert(lilv_node_as_uri(plug));
+        }
+        if (applies) lilv_nodes_free(applies);
+    }
+    if (all) lilv_nodes_free(all);
+    lilv_node_free(lv2_appliesTo);
+    lilv_node_free(rdf_type);
+    lilv_node_free(pset_Preset);
+    for (std::set<std::string>::iterator it = plugs.begin(); it != plugs.end(); ++it) {
+        presets.erase(*it);
+        build_plugin(world, *it);
+    }
+}
+
+const std::vector<PresetEntry>* PresetIndex::find(const std::string& uri) const {
+    std::unordered_map<std::string, std::vector<PresetEntry> >::const_iterator it = presets.find(uri);
+    if (it == presets.end()) return NULL;
+    return &it->second;
+}
+
+
+///*** ----------- Class ClassIndex functions ----------- ***///
+
+void ClassIndex::clear() {
+    classes.clear();
+    ids.clear();
+}
+
+uint32_t ClassIndex::add_class(const std::string& uri, const std::string& label) {
+    PluginClass c;
+    c.uri = uri;
+    c.label = label.empty() ? uri : label;
+    c.parent = -1;
+    classes.push_back(c);
+    ids[uri] = classes.size() - 1;
+    return classes.size() - 1;
+}
+
+// the class data comes with the specifications, so this is cheap
+// even when the plugins themselves weren't parsed
+void ClassIndex::build(LilvWorld* world) {
+    clear();
+    std::vector<std::string> parents;
+    const LilvPluginClasses* lv2_classes = lilv_world_get_plugin_classes(world);
+    LILV_FOREACH(plugin_classes, it, lv2_classes) {
+        const LilvPluginClass* cls = lilv_plugin_classes_get(lv2_classes, it);
+        const LilvNode* label = lilv_plugin_class_get_label(cls);
+        const LilvNode* parent = lilv_plugin_class_get_parent_uri(cls);
+        add_class(lilv_node_as_uri(lilv_plugin_class_get_uri(cls)),
+                  label ? lilv_node_as_string(label) : "");
+        parents.push_back(parent ? lilv_node_as_uri(parent) : "");
+    }
+    for (size_t i = 0; i < classes.size(); i++) {
+        int32_t p = find(parents[i]);
+        if (p < 0 || (size_t)p == i) continue;
+        classes[i].parent = p;
+        classes[p].children.push_back(i);
+    }
+}
+
+int32_t ClassIndex::find(const std::string& uri) const {
+    std::unordered_map<std::string, uint32_t>::const_iterator it = ids.find(uri);
+    if (it == ids.end()) return -1;
+    return it->second;
+}
+
+// drops the plugins, the tree stays
+void ClassIndex::reset(size_t n) {
+    for (std::vector<PluginClass>::iterator it = classes.begin(); it != classes.end(); ++it) {
+        it->plugins.clear();
+        it->plugins.resize(n);
+    }
+}
+
+// the plugin goes into its class and every class above it
+void ClassIndex::add_plugin(size_t i, const std::string& uri, const std::string& label) {
+    if (uri.empty()) return;
+    int32_t c = find(uri);
+    if (c < 0) c = add_class(uri, label);
+    // a broken class file may loop, the depth can't exceed the class count
+    for (size_t depth = 0; c >= 0 && depth < classes.size(); depth++) {
+        if (classes[c].plugins.size() <= i) classes[c].plugins.resize(i + 1);
+        classes[c].plugins.set(i, true);
+        c = classes[c].parent;
+    }
+}
+
+
+///*** ----------- Class Catalog functions ----------- ***///
+
+// on-disk layout: header | bundles | records | presets | string table
+// all strings are stored as offsets into the NUL separated string table
+
+#define CATALOG_MAGIC "JSELCAT"
+#define CATALOG_VERSION 4
+#define CATALOG_NONE 0xffffffff
+#define CATALOG_VALID 1
+#define CATALOG_LATENCY 2
+#define CATALOG_HARD_RT 4
+// the preset index was complete when the cache was written
+#define CATALOG_PRESETS 1
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_bundles;
+    uint32_t n_records;
+    uint32_t n_presets;
+    uint32_t strtab_size;
+    uint32_t flags;
+    uint64_t key;
+};
+
+struct CacheBundle {
+    uint32_t path;
+    uint32_t pad;
+    int64_t mtime;
+};
+
+struct CacheRecord {
+    uint32_t bundle;
+    uint32_t uri;
+    uint32_t name;
+    uint32_t cls;
+    uint32_t cls_uri;
+    uint32_t author;
+    uint16_t audio_in;
+    uint16_t audio_out;
+    uint16_t midi_in;
+    uint16_t midi_out;
+    uint16_t control_in;
+    uint16_t control_out;
+    uint16_t cv_in;
+    uint16_t cv_out;
+    uint32_t flags;
+    uint32_t required;
+};
+
+struct CachePreset {
+    uint32_t plugin;
+    uint32_t uri;
+    uint32_t label;
+    uint32_t doc;
+};
+
+class StringTable {
+    std::map<std::string, uint32_t> offsets;
+public:
+    std::string data;
+    uint32_t add(const std::string& s) {
+        std::map<std::string, uint32_t>::iterator it = offsets.find(s);
+        if (it != offsets.end()) return it->second;
+        uint32_t off = data.size();
+        data += s;
+        data += '\0';
+        offsets[s] = off;
+        return off;
+    }
+};
+
+static uint32_t record_flags(const CatalogRecord& r) {
+    return (r.valid ? CATALOG_VALID : 0) | (r.latency ? CATALOG_LATENCY : 0) |
+           (r.hard_rt ? CATALOG_HARD_RT : 0);
+}
+
+static uint64_t hash_string(const std::string& s) {
+    uint64_t h = 14695981039346656037ULL; // FNV-1a
+    for (std::string::const_iterator it = s.begin(); it != s.end(); ++it) {
+        h ^= (unsigned char)(*it);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static int64_t stat_mtime(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return -1;
+    return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+// newest mtime of the bundle directory and its top level turtle files,
+// or -1 when the directory isn't a LV2 bundle
+static int64_t bundle_mtime(const std::string& path) {
+    int64_t mtime = stat_mtime(path + "manifest.ttl");
+    if (mtime < 0) return -1;
+    mtime = std::max(mtime, stat_mtime(path));
+    DIR* d = opendir(path.c_str());
+    if (!d) return mtime;
+    for (struct dirent* e = readdir(d); e; e = readdir(d)) {
+        size_t len = strlen(e->d_name);
+        if (len > 4 && strcmp(e->d_name + len - 4, ".ttl") == 0) {
+            mtime = std::max(mtime, stat_mtime(path + e->d_name));
+        }
+    }
+    closedir(d);
+    return mtime;
+}
+
+static std::string real_path(const std::string& path) {
+    char* r = realpath(path.c_str(), NULL);
+    if (!r) return path;
+    std::string ret = r;
+    free(r);
+    if (ret.empty() || ret[ret.size()-1] != '/') ret += "/";
+    return ret;
+}
+
+static std::vector<std::string> lv2_path_dirs() {
+    std::vector<std::string> dirs;
+    const char* env = getenv("LV2_PATH");
+    std::stringstream ss(env ? env : "~/.lv2:/usr/local/lib/lv2:/usr/lib/lv2");
+    std::string dir;
+    while (std::getline(ss, dir, ':')) {
+        if (dir.empty()) continue;
+        if (dir[0] == '~') dir = Glib::get_home_dir() + dir.substr(1);
+        while (dir.size() > 1 && dir[dir.size()-1] == '/') dir.erase(dir.size()-1);
+        dirs.push_back(dir);
+    }
+    return dirs;
+}
+
+Catalog::Catalog() :
+    key(0),
+    cacheable(false),
+    published(0),
+    world(NULL),
+    world_complete(false),
+    presets_complete(false),
+    from_cache(false),
+    parsed_bundles(0),
+    cancelled(false),
+    jobs(0) {
+}
+
+Catalog::~Catalog() {
+    clear();
+}
+
+void Catalog::clear() {
+    if (world) lilv_world_free(world);
+    world = NULL;
+    world_complete = false;
+    presets.clear();
+    classes.clear();
+    presets_complete = false;
+    from_cache = false;
+    parsed_bundles = 0;
+    published = 0;
+    bundles.clear();
+    records.clear();
+}
+
+// hand new records out in batches, so a list can show them while we parse
+void Catalog::publish(uint32_t total) {
+    if (records.size() > published) {
+        on_records(&records[published], records.size() - published);
+        published = records.size();
+    }
+    on_progress(published, total);
+}
+
+void Catalog::scan_bundles() {
+    std::vector<std::string> dirs = lv2_path_dirs();
+    std::string k;
+    for (std::vector<std::string>::iterator it = dirs.begin(); it != dirs.end(); ++it) {
+        k += (*it) + ":";
+        DIR* d = opendir(it->c_str());
+        if (!d) continue;
+        std::vector<std::string> names;
+        for (struct dirent* e = readdir(d); e; e = readdir(d)) {
+            if (e->d_name[0] != '.') names.push_back(e->d_name);
+        }
+        closedir(d);
+        sort(names.begin(), names.end());
+        for (std::vector<std::string>::iterator n = names.begin(); n != names.end(); ++n) {
+            CatalogBundle b;
+            b.path = (*it) + "/" + (*n) + "/";
+            b.mtime = bundle_mtime(b.path);
+            if (b.mtime >= 0) bundles.push_back(b);
+        }
+    }
+    // plugin names are localised, so the language is part of the key
+    const char* lang = getenv("LANG");
+    k += lang ? lang : "";
+    key = hash_string(k);
+    char name[64];
+    snprintf(name, sizeof(name), "catalog-%016llx.bin", (unsigned long long)key);
+    cache_file = Glib::build_filename(Glib::get_user_cache_dir(), "jalv.select", name);
+}
+
+bool Catalog::read_cache(std::vector<CatalogBundle> *cached_bundles,
+                         std::vector<CatalogRecord> *cached_records,
+                         PresetIndex *cached_presets, bool *has_presets) {
+    int fd = open(cache_file.c_str(), O_RDONLY);
+    if (fd == -1) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CacheHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const char* base = (const char*)map;
+    const CacheHeader* h = (const CacheHeader*)base;
+    size_t bundles_off = sizeof(CacheHeader);
+    size_t records_off = bundles_off + (size_t)h->n_bundles * sizeof(CacheBundle);
+    size_t presets_off = records_off + (size_t)h->n_records * sizeof(CacheRecord);
+    size_t strtab_off = presets_off + (size_t)h->n_presets * sizeof(CachePreset);
+    bool ok = memcmp(h->magic, CATALOG_MAGIC, 8) == 0 && h->version == CATALOG_VERSION &&
+              h->key == key && strtab_off + h->strtab_size == size &&
+              h->strtab_size > 0 && base[size - 1] == '\0';
+    if (ok) {
+        const CacheBundle* cb = (const CacheBundle*)(base + bundles_off);
+        const CacheRecord* cr = (const CacheRecord*)(base + records_off);
+        const char* strtab = base + strtab_off;
+        uint32_t n = h->strtab_size;
+        for (uint32_t i = 0; ok && i < h->n_bundles; i++) {
+            if (cb[i].path >= n) { ok = false; break; }
+            CatalogBundle b;
+            b.path = strtab + cb[i].path;
+            b.mtime = cb[i].mtime;
+            cached_bundles->push_back(b);
+        }
+        for (uint32_t i = 0; ok && i < h->n_records; i++) {
+            if (cr[i].bundle >= h->n_bundles || cr[i].uri >= n || cr[i].name >= n ||
+                cr[i].cls >= n || cr[i].cls_uri >= n || cr[i].author >= n ||
+                cr[i].required >= n) {
+                ok = false;
+                break;
+            }
+            CatalogRecord r;
+            r.bundle = cr[i].bundle;
+            r.uri = strtab + cr[i].uri;
+            r.name = strtab + cr[i].name;
+            r.cls = strtab + cr[i].cls;
+            r.cls_uri = strtab + cr[i].cls_uri;
+            r.author = strtab + cr[i].author;
+            r.audio_in = cr[i].audio_in;
+            r.audio_out = cr[i].audio_out;
+            r.midi_in = cr[i].midi_in;
+            r.midi_out = cr[i].midi_out;
+            r.control_in = cr[i].control_in;
+            r.control_out = cr[i].control_out;
+            r.cv_in = cr[i].cv_in;
+            r.cv_out = cr[i].cv_out;
+            r.required = strtab + cr[i].required;
+            r.latency = cr[i].flags & CATALOG_LATENCY;
+            r.hard_rt = cr[i].flags & CATALOG_HARD_RT;
+            r.valid = cr[i].flags & CATALOG_VALID;
+            cached_records->push_back(r);
+        }
+        // stored plugin by plugin in label order
+        const CachePreset* cp = (const CachePreset*)(base + presets_off);
+        for (uint32_t i = 0; ok && i < h->n_presets; i++) {
+            if (cp[i].plugin >= n || cp[i].uri >= n || cp[i].label >= n || cp[i].doc >= n) {
+                ok = false;
+                break;
+            }
+            PresetEntry e;
+            e.uri = strtab + cp[i].uri;
+            e.label = strtab + cp[i].label;
+            e.doc = strtab + cp[i].doc;
+            cached_presets->append(strtab + cp[i].plugin, e);
+        }
+        *has_presets = ok && (h->flags & CATALOG_PRESETS);
+    }
+    munmap(map, size);
+    if (!ok) {
+        cached_bundles->clear();
+        cached_records->clear();
+        cached_presets->clear();
+    }
+    return ok;
+}
+
+void Catalog::write_cache() {
+    if (!cacheable) return;
+    StringTable strtab;
+    strtab.add("");
+    std::vector<CacheBundle> cb(bundles.size());
+    for (size_t i = 0; i < bundles.size(); i++) {
+        cb[i].path = strtab.add(bundles[i].path);
+        cb[i].pad = 0;
+        cb[i].mtime = bundles[i].mtime;
+    }
+    std::vector<CacheRecord> cr(records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        cr[i].bundle = records[i].bundle;
+        cr[i].uri = strtab.add(records[i].uri);
+        cr[i].name = strtab.add(records[i].name);
+        cr[i].cls = strtab.add(records[i].cls);
+        cr[i].cls_uri = strtab.add(records[i].cls_uri);
+        cr[i].author = strtab.add(records[i].author);
+        cr[i].audio_in = records[i].audio_in;
+        cr[i].audio_out = records[i].audio_out;
+        cr[i].midi_in = records[i].midi_in;
+        cr[i].midi_out = records[i].midi_out;
+        cr[i].control_in = records[i].control_in;
+        cr[i].control_out = records[i].control_out;
+        cr[i].cv_in = records[i].cv_in;
+        cr[i].cv_out = records[i].cv_out;
+        cr[i].flags = record_flags(records[i]);
+        cr[i].required = strtab.add(records[i].required);
+    }
+    std::vector<CachePreset> cp;
+    if (presets_complete) {
+        const std::unordered_map<std::string, std::vector<PresetEntry> >& all = presets.entries();
+        for (std::unordered_map<std::string, std::vector<PresetEntry> >::const_iterator it = all.begin();
+                                                                     it != all.end(); ++it) {
+            for (std::vector<PresetEntry>::const_iterator e = it->second.begin(); e != it->second.end(); ++e) {
+                CachePreset p;
+                p.plugin = strtab.add(it->first);
+                p.uri = strtab.add(e->uri);
+                p.label = strtab.add(e->label);
+                p.doc = strtab.add(e->doc);
+                cp.push_back(p);
+            }
+        }
+    }
+    CacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CATALOG_MAGIC, 8);
+    h.version = CATALOG_VERSION;
+    h.n_bundles = cb.size();
+    h.n_records = cr.size();
+    h.n_presets = cp.size();
+    h.strtab_size = strtab.data.size();
+    h.flags = presets_complete ? CATALOG_PRESETS : 0;
+    h.key = key;
+
+    g_mkdir_with_parents(Glib::path_get_dirname(cache_file).c_str(), 0755);
+    // write to a temporary file and rename it, so a running instance never
+    // maps a half written catalog
+    std::string tmp = cache_file + "." + to_string(getpid());
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if (!fp) return;
+    bool ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+    if (ok && !cb.empty()) ok = fwrite(&cb[0], sizeof(CacheBundle), cb.size(), fp) == cb.size();
+    if (ok && !cr.empty()) ok = fwrite(&cr[0], sizeof(CacheRecord), cr.size(), fp) == cr.size();
+    if (ok && !cp.empty()) ok = fwrite(&cp[0], sizeof(CachePreset), cp.size(), fp) == cp.size();
+    if (ok) ok = fwrite(strtab.data.data(), 1, strtab.data.size(), fp) == strtab.data.size();
+    if (fclose(fp) != 0) ok = false;
+    if (!ok || rename(tmp.c_str(), cache_file.c_str()) != 0) {
+        unlink(tmp.c_str());
+    }
+}
+
+void Catalog::new_nodes() {
+    lv2_AudioPort = lilv_new_uri(world, LV2_CORE__AudioPort);
+    lv2_InputPort = lilv_new_uri(world, LV2_CORE__InputPort);
+    lv2_OutputPort = lilv_new_uri(world, LV2_CORE__OutputPort);
+    lv2_MidiPort = lilv_new_uri(world, LILV_URI_MIDI_EVENT);
+    lv2_AtomPort = lilv_new_uri(world, LV2_ATOM__AtomPort);
+    lv2_atom_supports = lilv_new_uri(world, LV2_ATOM__supports);
+    lv2_ControlPort = lilv_new_uri(world, LV2_CORE__ControlPort);
+    lv2_CVPort = lilv_new_uri(world, LV2_CORE__CVPort);
+    lv2_hardRTCapable = lilv_new_uri(world, LV2_CORE__hardRTCapable);
+}
+
+void Catalog::free_nodes() {
+    lilv_node_free(lv2_AudioPort);
+    lilv_node_free(lv2_InputPort);
+    lilv_node_free(lv2_OutputPort);
+    lilv_node_free(lv2_MidiPort);
+    lilv_node_free(lv2_AtomPort);
+    lilv_node_free(lv2_atom_supports);
+    lilv_node_free(lv2_ControlPort);
+    lilv_node_free(lv2_CVPort);
+    lilv_node_free(lv2_hardRTCapable);
+}
+
+// expects the nodes from new_nodes() for the current world
+void Catalog::add_plugin(const LilvPlugin* plug, uint32_t bundle) {
+    CatalogRecord rec;
+    rec.bundle = bundle;
+    rec.uri = lilv_node_as_uri(lilv_plugin_get_uri(plug));
+    LilvNode* nd = lilv_plugin_get_name(plug);
+    rec.valid = nd != NULL;
+    if (nd) {
+        rec.name = lilv_node_as_string(nd);
+        lilv_node_free(nd);
+    }
+    const LilvPluginClass* cls = lilv_plugin_get_class(plug);
+    if (cls && lilv_plugin_class_get_label(cls)) {
+        rec.cls = lilv_node_as_string(lilv_plugin_class_get_label(cls));
+    }
+    if (cls) {
+        rec.cls_uri = lilv_node_as_uri(lilv_plugin_class_get_uri(cls));
+    }
+    nd = lilv_plugin_get_author_name(plug);
+    if (!nd) {
+        nd = lilv_plugin_get_project(plug);
+    }
+    if (nd) {
+        rec.author = lilv_node_as_string(nd);
+        lilv_node_free(nd);
+    }
+    rec.audio_in = 0;
+    rec.audio_out = 0;
+    rec.midi_in = 0;
+    rec.midi_out = 0;
+    rec.control_in = 0;
+    rec.control_out = 0;
+    rec.cv_in = 0;
+    rec.cv_out = 0;
+    rec.latency = lilv_plugin_has_latency(plug);
+    rec.hard_rt = lilv_plugin_has_feature(plug, lv2_hardRTCapable);
+    LilvNodes* features = lilv_plugin_get_required_features(plug);
+    LILV_FOREACH(nodes, i, features) {
+        if (!rec.required.empty()) rec.required += " ";
+        rec.required += lilv_node_as_uri(lilv_nodes_get(features, i));
+    }
+    if (features) lilv_nodes_free(features);
+    unsigned int num_ports = lilv_plugin_get_num_ports(plug);
+    for (unsigned int n = 0; n < num_ports; n++) {
+        const LilvPort* port = lilv_plugin_get_port_by_index(plug, n);
+        bool input = lilv_port_is_a(plug, port, lv2_InputPort);
+        if (lilv_port_is_a(plug, port, lv2_AudioPort)) {
+            if (input) {
+                rec.audio_in += 1;
+            } else {
+                rec.audio_out += 1;
+            }
+        } else if (lilv_port_is_a(plug, port, lv2_ControlPort)) {
+            if (input) {
+                rec.control_in += 1;
+            } else {
+                rec.control_out += 1;
+            }
+        } else if (lilv_port_is_a(plug, port, lv2_CVPort)) {
+            if (input) {
+                rec.cv_in += 1;
+            } else {
+                rec.cv_out += 1;
+            }
+        } else if (lilv_port_is_a(plug, port, lv2_AtomPort)) {
+            LilvNodes* atom_supports = lilv_port_get_value(
+              plug, port, lv2_atom_supports);
+            if (lilv_nodes_contains(atom_supports, lv2_MidiPort)) {
+                if (input) {
+                    rec.midi_in += 1;
+                }
+                if (lilv_port_is_a(plug, port, lv2_OutputPort)) {
+                    rec.midi_out += 1;
+                }
+            }
+            lilv_nodes_free(atom_supports);
+        }
+    }
+    records.push_back(rec);
+}
+
+uint32_t Catalog::find_bundle(const LilvPlugin* plug,
+                              const std::vector<std::string>& real_paths) {
+    char* path = lilv_file_uri_parse(
+      lilv_node_as_uri(lilv_plugin_get_bundle_uri(plug)), NULL);
+    if (!path) return CATALOG_NONE;
+    std::string rp = real_path(path);
+    free(path);
+    std::vector<std::string>::const_iterator it =
+      std::find(real_paths.begin(), real_paths.end(), rp);
+    if (it == real_paths.end()) return CATALOG_NONE;
+    return it - real_paths.begin();
+}
+
+void Catalog::parse_all() {
+    records.clear();
+    published = 0;
+    uint32_t n = shard_count(bundles.size());
+    if (n > 1) {
+        std::vector<uint32_t> all;
+        for (size_t i = 0; i < bundles.size(); i++) all.push_back(i);
+        // the world for the presets gets loaded later by get_world()
+        if (parse_sharded(all, n)) return;
+    }
+    world = lilv_world_new();
+    lilv_world_load_all(world);
+    world_complete = true;
+    parsed_bundles = bundles.size();
+    std::vector<std::string> real_paths;
+    for (std::vector<CatalogBundle>::iterator it = bundles.begin(); it != bundles.end(); ++it) {
+        real_paths.push_back(real_path(it->path));
+    }
+    const LilvPlugins* lv2_plugins = lilv_world_get_all_plugins(world);
+    uint32_t total = lilv_plugins_size(lv2_plugins);
+    new_nodes();
+    LILV_FOREACH(plugins, it, lv2_plugins) {
+        if (cancelled) break;
+        const LilvPlugin* plug = lilv_plugins_get(lv2_plugins, it);
+        if (!plug) continue;
+        uint32_t bundle = find_bundle(plug, real_paths);
+        // a plugin we can't relate to a bundle would never be invalidated
+        if (bundle == CATALOG_NONE) cacheable = false;
+        add_plugin(plug, bundle);
+        if (records.size() - published >= 64) publish(total);
+    }
+    free_nodes();
+    publish(total);
+}
+
+void Catalog::parse_bundles(const std::vector<uint32_t>& changed) {
+    world = lilv_world_new();
+    std::vector<bool> load(bundles.size(), false);
+    for (std::vector<uint32_t>::const_iterator it = changed.begin(); it != changed.end(); ++it) {
+        load[*it] = true;
+    }
+    std::vector<bool> wanted = load;
+    // the plugin class labels live in lv2core, without it every plugin is a "Plugin"
+    for (size_t i = 0; i < bundles.size(); i++) {
+        if (stat_mtime(bundles[i].path + "lv2core.ttl") >= 0) load[i] = true;
+    }
+    std::vector<std::string> real_paths;
+    for (size_t i = 0; i < bundles.size(); i++) {
+        real_paths.push_back(wanted[i] ? real_path(bundles[i].path) : std::string());
+        if (!load[i]) continue;
+        LilvNode* bundle = lilv_new_file_uri(world, NULL, bundles[i].path.c_str());
+        lilv_world_load_bundle(world, bundle);
+        lilv_node_free(bundle);
+    }
+    lilv_world_load_specifications(world);
+    lilv_world_load_plugin_classes(world);
+    parsed_bundles = changed.size();
+
+    const LilvPlugins* lv2_plugins = lilv_world_get_all_plugins(world);
+    uint32_t total = records.size() + lilv_plugins_size(lv2_plugins);
+    new_nodes();
+    LILV_FOREACH(plugins, it, lv2_plugins) {
+        if (cancelled) break;
+        const LilvPlugin* plug = lilv_plugins_get(lv2_plugins, it);
+        if (!plug) continue;
+        uint32_t bundle = find_bundle(plug, real_paths);
+        if (bundle != CATALOG_NONE) add_plugin(plug, bundle);
+        if (records.size() - published >= 64) publish(total);
+    }
+    free_nodes();
+    publish(total);
+    // the partial world is only good for the catalog, presets need all bundles
+    lilv_world_free(world);
+    world = NULL;
+}
+
+///*** ----------- parsing in helper processes ----------- ***///
+
+// a lilv world is single threaded, so large trees are split over processes,
+// each loads its share of the bundles and sends back the records as
+// ShardRecord | uri | name | class | author
+
+#define SHARD_MIN_BUNDLES 64 // below that a helper costs more than it saves
+
+struct ShardRecord {
+    uint32_t bundle;
+    uint16_t audio_in;
+    uint16_t audio_out;
+    uint16_t midi_in;
+    uint16_t midi_out;
+    uint16_t control_in;
+    uint16_t control_out;
+    uint16_t cv_in;
+    uint16_t cv_out;
+    uint32_t flags;
+    uint32_t len[6];
+};
+
+struct CatalogShard {
+    pid_t pid;
+    int fd;
+    std::string buf;
+    std::vector<uint32_t> todo;
+};
+
+static void write_shard_record(FILE* fp, const CatalogRecord& r) {
+    ShardRecord s;
+    memset(&s, 0, sizeof(s));
+    s.bundle = r.bundle;
+    s.audio_in = r.audio_in;
+    s.audio_out = r.audio_out;
+    s.midi_in = r.midi_in;
+    s.midi_out = r.midi_out;
+    s.control_in = r.control_in;
+    s.control_out = r.control_out;
+    s.cv_in = r.cv_in;
+    s.cv_out = r.cv_out;
+    s.flags = record_flags(r);
+    s.len[0] = r.uri.size();
+    s.len[1] = r.name.size();
+    s.len[2] = r.cls.size();
+    s.len[3] = r.author.size();
+    s.len[4] = r.cls_uri.size();
+    s.len[5] = r.required.size();
+    fwrite(&s, sizeof(s), 1, fp);
+    fwrite(r.uri.data(), 1, r.uri.size(), fp);
+    fwrite(r.name.data(), 1, r.name.size(), fp);
+    fwrite(r.cls.data(), 1, r.cls.size(), fp);
+    fwrite(r.author.data(), 1, r.author.size(), fp);
+    fwrite(r.cls_uri.data(), 1, r.cls_uri.size(), fp);
+    fwrite(r.required.data(), 1, r.required.size(), fp);
+}
+
+// appends the complete records at the start of buf, returns their size
+static size_t read_shard_records(const std::string& buf, std::vector<CatalogRecord>* records) {
+    size_t pos = 0;
+    while (buf.size() - pos >= sizeof(ShardRecord)) {
+        ShardRecord s;
+        memcpy(&s, buf.data() + pos, sizeof(s));
+        size_t len = 0;
+        for (int32_t k = 0; k < 6; k++) len += s.len[k];
+        if (buf.size() - pos - sizeof(s) < len) break;
+        const char* p = buf.data() + pos + sizeof(s);
+        CatalogRecord r;
+        r.bundle = s.bundle;
+        r.uri.assign(p, s.len[0]);
+        p += s.len[0];
+        r.name.assign(p, s.len[1]);
+        p += s.len[1];
+        r.cls.assign(p, s.len[2]);
+        p += s.len[2];
+        r.author.assign(p, s.len[3]);
+        p += s.len[3];
+        r.cls_uri.assign(p, s.len[4]);
+        p += s.len[4];
+        r.required.assign(p, s.len[5]);
+        r.audio_in = s.audio_in;
+        r.audio_out = s.audio_out;
+        r.midi_in = s.midi_in;
+        r.midi_out = s.midi_out;
+        r.control_in = s.control_in;
+        r.control_out = s.control_out;
+        r.cv_in = s.cv_in;
+        r.cv_out = s.cv_out;
+        r.latency = s.flags & CATALOG_LATENCY;
+        r.hard_rt = s.flags & CATALOG_HARD_RT;
+        r.valid = s.flags & CATALOG_VALID;
+        records->push_back(r);
+        pos += sizeof(s) + len;
+    }
+    return pos;
+}
+
+uint32_t Catalog::shard_count(size_t n) const {
+    if (jobs) return std::max<size_t>(1, std::min<size_t>(jobs, n));
+    size_t j = std::min<size_t>(std::thread::hardware_concurrency(), n / SHARD_MIN_BUNDLES);
+    return std::max<size_t>(1, j);
+}
+
+// the bundles go round robin to n helpers, the records come in as they are
+// parsed and sort_records() later keeps the one of the lowest bundle index
+// for a duplicate URI, whichever helper was faster. The bundles of a helper
+// which fails get parsed here. False when no helper could be started.
+bool Catalog::parse_sharded(const std::vector<uint32_t>& todo, uint32_t n) {
+    TraceSpan span("sharded parse", to_string(n));
+    // the plugin class labels live in lv2core, every helper needs it
+    std::string common;
+    for (size_t i = 0; i < bundles.size(); i++) {
+        if (stat_mtime(bundles[i].path + "lv2core.ttl") >= 0) common += "-\t" + bundles[i].path + "\n";
+    }
+    std::vector<CatalogShard> shards(n);
+    for (size_t k = 0; k < todo.size(); k++) shards[k % n].todo.push_back(todo[k]);
+    std::vector<uint32_t> failed;
+    size_t running = 0;
+    for (std::vector<CatalogShard>::iterator s = shards.begin(); s != shards.end(); ++s) {
+        s->pid = -1;
+        s->fd = -1;
+        int sv[2];
+        int err = socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) ? errno : 0;
+        if (!err) {
+            posix_spawn_file_actions_t fa;
+            posix_spawn_file_actions_init(&fa);
+            posix_spawn_file_actions_adddup2(&fa, sv[1], 0);
+            posix_spawn_file_actions_adddup2(&fa, sv[1], 1);
+            const char* argv[] = { "jalv.select", "--catalog-helper", NULL };
+            err = posix_spawn(&s->pid, "/proc/self/exe", &fa, NULL, (char* const*)argv, environ);
+            posix_spawn_file_actions_destroy(&fa);
+            close(sv[1]);
+            if (err) close(sv[0]);
+        }
+        if (err) {
+            fprintf(stderr, "jalv.select: can't start a catalog helper: %s\n", strerror(err));
+            s->pid = -1;
+            failed.insert(failed.end(), s->todo.begin(), s->todo.end());
+            continue;
+        }
+        s->fd = sv[0];
+        std::string input = common;
+        for (std::vector<uint32_t>::iterator b = s->todo.begin(); b != s->todo.end(); ++b) {
+            input += to_string(*b) + "\t" + bundles[*b].path + "\n";
+        }
+        // the helper reads all of it before it writes anything
+        for (size_t off = 0; off < input.size();) {
+            ssize_t w = send(s->fd, input.data() + off, input.size() - off, MSG_NOSIGNAL);
+            if (w < 0 && errno == EINTR) continue;
+            if (w < 0) break;
+            off += w;
+        }
+        shutdown(s->fd, SHUT_WR);
+        running++;
+    }
+    if (!running) return false;
+
+    std::vector<struct pollfd> fds;
+    std::vector<CatalogShard*> polled;
+    while (running && !cancelled) {
+        fds.clear();
+        polled.clear();
+        for (std::vector<CatalogShard>::iterator s = shards.begin(); s != shards.end(); ++s) {
+            if (s->fd < 0) continue;
+            struct pollfd p = { s->fd, POLLIN, 0 };
+            fds.push_back(p);
+            polled.push_back(&(*s));
+        }
+        // wakes up now and then to look at cancelled
+        if (poll(&fds[0], fds.size(), 100) < 0 && errno != EINTR) {
+            fprintf(stderr, "jalv.select: poll failed: %s, parsing the remaining bundles here\n",
+                    strerror(errno));
+            break;
+        }
+        for (size_t f = 0; f < fds.size(); f++) {
+            if (!fds[f].revents) continue;
+            CatalogShard* s = polled[f];
+            char buf[65536];
+            ssize_t r = read(s->fd, buf, sizeof(buf));
+            if (r > 0) {
+                s->buf.append(buf, r);
+                s->buf.erase(0, read_shard_records(s->buf, &records));
+                if (records.size() - published >= 64) publish(0);
+                continue;
+            }
+            if (r < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+            close(s->fd);
+            s->fd = -1;
+            running--;
+            int status = 0;
+            waitpid(s->pid, &status, 0);
+            s->pid = -1;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || !s->buf.empty()) {
+                fprintf(stderr, "jalv.select: a catalog helper failed, parsing its bundles here\n");
+                failed.insert(failed.end(), s->todo.begin(), s->todo.end());
+            }
+        }
+    }
+    // a helper still running here was cancelled or lost to a poll error,
+    // its records may be incomplete
+    for (std::vector<CatalogShard>::iterator s = shards.begin(); s != shards.end(); ++s) {
+        if (s->pid < 0) continue;
+        kill(s->pid, SIGTERM);
+        close(s->fd);
+        waitpid(s->pid, NULL, 0);
+        failed.insert(failed.end(), s->todo.begin(), s->todo.end());
+    }
+    if (cancelled) return true;
+    // records of a failed helper which made it here are dropped as duplicates
+    if (!failed.empty()) parse_bundles(failed);
+    parsed_bundles = todo.size();
+    publish(records.size());
+    return true;
+}
+
+// --catalog-helper, the other end of parse_sharded(): reads "index<TAB>path"
+// lines from stdin, "-" as index loads a bundle for the class labels only,
+// and writes the records of the plugins in the indexed bundles to stdout
+int32_t Catalog::run_helper() {
+    Catalog catalog;
+    catalog.world = lilv_world_new();
+    std::vector<std::string> real_paths;
+    char* line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    while ((len = getline(&line, &size, stdin)) > 0) {
+        if (line[len - 1] == '\n') line[len - 1] = '\0';
+        char* tab = strchr(line, '\t');
+        if (!tab) continue;
+        *tab = '\0';
+        if (strcmp(line, "-") != 0) {
+            uint32_t i = strtoul(line, NULL, 10);
+            if (real_paths.size() <= i) real_paths.resize(i + 1);
+            real_paths[i] = real_path(tab + 1);
+        }
+        LilvNode* bundle = lilv_new_file_uri(catalog.world, NULL, tab + 1);
+        lilv_world_load_bundle(catalog.world, bundle);
+        lilv_node_free(bundle);
+    }
+    free(line);
+    lilv_world_load_specifications(catalog.world);
+    lilv_world_load_plugin_classes(catalog.world);
+
+    const LilvPlugins* lv2_plugins = lilv_world_get_all_plugins(catalog.world);
+    catalog.new_nodes();
+    LILV_FOREACH(plugins, it, lv2_plugins) {
+        const LilvPlugin* plug = lilv_plugins_get(lv2_plugins, it);
+        if (!plug) continue;
+        uint32_t bundle = catalog.find_bundle(plug, real_paths);
+        if (bundle == CATALOG_NONE) continue;
+        catalog.add_plugin(plug, bundle);
+        write_shard_record(stdout, catalog.records.back());
+        // the parent streams them into the list
+        if (catalog.records.size() % 64 == 0) fflush(stdout);
+    }
+    catalog.free_nodes();
+    return fflush(stdout) == 0 && !ferror(stdout) ? 0 : 1;
+}
+
+static bool record_less(const CatalogRecord& a, const CatalogRecord& b) {
+    int c = a.uri.compare(b.uri);
+    if (c != 0) return c < 0;
+    return a.bundle < b.bundle;
+}
+
+static bool record_same_uri(const CatalogRecord& a, const CatalogRecord& b) {
+    return a.uri == b.uri;
+}
+
+// keep one record per plugin URI, the bundle found first in LV2_PATH wins
+void Catalog::sort_records() {
+    std::sort(records.begin(), records.end(), record_less);
+    records.erase(std::unique(records.begin(), records.end(), record_same_uri), records.end());
+}
+
+void Catalog::load(bool rescan) {
+    TraceSpan span("catalog load", rescan ? "rescan" : "");
+    clear();
+    cacheable = true;
+    scan_bundles();
+    std::vector<CatalogBundle> cached_bundles;
+    std::vector<CatalogRecord> cached_records;
+    PresetIndex cached_presets;
+    bool has_presets = false;
+    bool dirty = true;
+    if (rescan || !read_cache(&cached_bundles, &cached_records, &cached_presets, &has_presets)) {
+        parse_all();
+    } else {
+        from_cache = true;
+        std::map<std::string, uint32_t> by_path;
+        for (size_t i = 0; i < cached_bundles.size(); i++) {
+            by_path[cached_bundles[i].path] = i;
+        }
+        std::vector<uint32_t> remap(cached_bundles.size(), CATALOG_NONE);
+        std::vector<uint32_t> changed;
+        for (size_t i = 0; i < bundles.size(); i++) {
+            std::map<std::string, uint32_t>::iterator f = by_path.find(bundles[i].path);
+            if (f != by_path.end() && cached_bundles[f->second].mtime == bundles[i].mtime) {
+                remap[f->second] = i;
+            } else {
+                changed.push_back(i);
+            }
+        }
+        for (std::vector<CatalogRecord>::iterator it = cached_records.begin();
+                                    it != cached_records.end(); ++it) {
+            if (remap[it->bundle] == CATALOG_NONE) continue;
+            it->bundle = remap[it->bundle];
+            records.push_back(*it);
+        }
+        dirty = !changed.empty() || cached_bundles.size() != bundles.size();
+        // the preset labels hold as long as no bundle changed
+        if (!dirty && has_presets) {
+            presets.swap(cached_presets);
+            presets_complete = true;
+        }
+        if (changed.size() > bundles.size() / 2) {
+            // drops the cached records, so they aren't streamed first
+            parse_all();
+        } else if (!changed.empty()) {
+            publish(records.size());
+            uint32_t n = shard_count(changed.size());
+            if (n <= 1 || !parse_sharded(changed, n)) parse_bundles(changed);
+        } else {
+            publish(records.size());
+        }
+    }
+    if (cancelled) return;
+    sort_records();
+    if (dirty) write_cache();
+}
+
+LilvWorld* Catalog::get_world() {
+    if (!world_complete) {
+        TraceSpan span("world load");
+        if (world) lilv_world_free(world);
+        world = lilv_world_new();
+        lilv_world_load_all(world);
+        world_complete = true;
+    }
+    return world;
+}
+
+// the labels may have come with the cache, else they are
+// built once and the cache is written again with them
+void Catalog::index_presets() {
+    if (presets_complete) return;
+    TraceSpan span("preset index");
+    presets.build(get_world(), cancelled);
+    presets_complete = !cancelled;
+    if (presets_complete) write_cache();
+}
+
+void Catalog::index_classes() {
+    classes.build(get_world());
+}
+
+// starts a new generation with the records, presets and classes of the one
+// in use and takes over its loaded world, which only the loading thread uses
+void Catalog::copy_from(Catalog& other) {
+    if (world) lilv_world_free(world);
+    world = other.world;
+    world_complete = other.world_complete;
+    other.world = NULL;
+    other.world_complete = false;
+    cache_file = other.cache_file;
+    key = other.key;
+    cacheable = other.cacheable;
+    bundles = other.bundles;
+    records = other.records;
+    presets = other.presets;
+    presets_complete = other.presets_complete;
+    classes = other.classes;
+    from_cache = other.from_cache;
+}
+
+// runs in the loading thread, reloads the bundles which were added, removed
+// or changed since the last scan, changed gets the URIs of every plugin
+// whose record may differ now
+bool Catalog::update(std::set<std::string> *changed) {
+    TraceSpan span("bundle reload");
+    if (!world_complete) return false;
+    std::vector<CatalogBundle> old_bundles;
+    old_bundles.swap(bundles);
+    scan_bundles();
+    std::map<std::string, uint32_t> by_path;
+    for (size_t i = 0; i < bundles.size(); i++) {
+        by_path[bundles[i].path] = i;
+    }
+    std::vector<uint32_t> remap(old_bundles.size(), CATALOG_NONE);
+    std::vector<bool> reload(bundles.size(), true);
+    std::vector<std::string> bundle_uris;
+    for (size_t i = 0; i < old_bundles.size(); i++) {
+        std::map<std::string, uint32_t>::iterator f = by_path.find(old_bundles[i].path);
+        if (f != by_path.end() && bundles[f->second].mtime == old_bundles[i].mtime) {
+            remap[i] = f->second;
+            reload[f->second] = false;
+            continue;
+        }
+        LilvNode* bundle = lilv_new_file_uri(world, NULL, old_bundles[i].path.c_str());
+        lilv_world_unload_bundle(world, bundle);
+        bundle_uris.push_back(lilv_node_as_uri(bundle));
+        lilv_node_free(bundle);
+    }
+    parsed_bundles = 0;
+    for (size_t i = 0; i < bundles.size(); i++) {
+        if (!reload[i]) continue;
+        LilvNode* bundle = lilv_new_file_uri(world, NULL, bundles[i].path.c_str());
+        lilv_world_load_bundle(world, bundle);
+        bundle_uris.push_back(lilv_node_as_uri(bundle));
+        lilv_node_free(bundle);
+        parsed_bundles++;
+    }
+    if (bundle_uris.empty()) return false;
+
+    std::vector<CatalogRecord> old_records;
+    old_records.swap(records);
+    for (std::vector<CatalogRecord>::iterator it = old_records.begin(); it != old_records.end(); ++it) {
+        if (it->bundle == CATALOG_NONE) {
+            records.push_back(*it);
+        } else if (remap[it->bundle] != CATALOG_NONE) {
+            it->bundle = remap[it->bundle];
+            records.push_back(*it);
+        } else {
+            changed->insert(it->uri);
+        }
+    }
+    std::vector<std::string> real_paths;
+    for (std::vector<CatalogBundle>::iterator it = bundles.begin(); it != bundles.end(); ++it) {
+        real_paths.push_back(real_path(it->path));
+    }
+    const LilvPlugins* lv2_plugins = lilv_world_get_all_plugins(world);
+    new_nodes();
+    LILV_FOREACH(plugins, it, lv2_plugins) {
+        const LilvPlugin* plug = lilv_plugins_get(lv2_plugins, it);
+        if (!plug) continue;
+        uint32_t bundle = find_bundle(plug, real_paths);
+        if (bundle == CATALOG_NONE) continue;
+        std::string uri = lilv_node_as_uri(lilv_plugin_get_uri(plug));
+        // a plugin from an unchanged bundle only needs a record when it lost
+        // the one from a bundle which came first in LV2_PATH
+        if (!reload[bundle] && !changed->count(uri)) continue;
+        add_plugin(plug, bundle);
+        changed->insert(uri);
+    }
+    free_nodes();
+    sort_records();
+    presets.update(world, bundle_uris, *changed);
+    write_cache();
+    // a new bundle may bring new classes
+    classes.build(world);
+    return true;
+}
+
+
+///*** ----------- Class BundleWatcher functions ----------- ***///
+
+#define WATCH_EVENTS (IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+
+BundleWatcher::BundleWatcher()
+    : fd(-1) {
+}
+
+BundleWatcher::~BundleWatcher() {
+    io.disconnect();
+    settle.disconnect();
+    if (fd >= 0) close(fd);
+}
+
+// the LV2_PATH directories and every directory in them, a bundle is
+// watched before its manifest is written
+void BundleWatcher::watch() {
+    if (fd < 0) {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) {
+            fprintf(stderr, "jalv.select: inotify: %s\n", strerror(errno));
+            return;
+        }
+        io = Glib::signal_io().connect(
+          sigc::mem_fun(*this, &BundleWatcher::on_io), fd, Glib::IO_IN);
+    }
+    std::vector<std::string> dirs = lv2_path_dirs();
+    for (std::vector<std::string>::iterator it = dirs.begin(); it != dirs.end(); ++it) {
+        std::vector<std::string> paths(1, *it);
+        DIR* d = opendir(it->c_str());
+        if (!d) continue;
+        for (struct dirent* e = readdir(d); e; e = readdir(d)) {
+            if (e->d_name[0] != '.') paths.push_back((*it) + "/" + e->d_name);
+        }
+        closedir(d);
+        for (std::vector<std::string>::iterator p = paths.begin(); p != paths.end(); ++p) {
+            if (watched.count(*p)) continue;
+            int32_t wd = inotify_add_watch(fd, p->c_str(), WATCH_EVENTS);
+            if (wd < 0) continue;
+            watched.insert(*p);
+            watches[wd] = *p;
+        }
+    }
+}
+
+bool BundleWatcher::on_io(Glib::IOCondition condition) {
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        for (char* p = buf; p < buf + len; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len) {
+            const struct inotify_event* ev = (const struct inotify_event*)p;
+            // the directory is gone, it may come back under the same name
+            if (ev->mask & IN_IGNORED) {
+                watched.erase(watches[ev->wd]);
+                watches.erase(ev->wd);
+            }
+        }
+    }
+    // a bundle is written file by file, wait until it's quiet
+    settle.disconnect();
+    settle = Glib::signal_timeout().connect(
+      sigc::mem_fun(*this, &BundleWatcher::on_settle), 250);
+    return true;
+}
+
+bool BundleWatcher::on_settle() {
+    on_changed();
+    return false;
+}
+
+
+///*** ----------- Class ControlServer functions ----------- ***///
+
+#define CONTROL_MAX_FRAME (1 << 20)
+// how long a second instance waits for the running one to answer
+#define CONTROL_FORWARD_TIMEOUT 3000
+
+std::string ControlServer::socket_path() {
+    return Glib::build_filename(Glib::get_user_runtime_dir(), "jalv.select.socket");
+}
+
+// waits for the socket until the deadline, in monotonic microseconds
+static bool control_wait(int32_t fd, short events, gint64 deadline) {
+    for (;;) {
+        gint64 left = (deadline - g_get_monotonic_time()) / 1000;
+        if (left <= 0) return false;
+        struct pollfd pfd = { fd, events, 0 };
+        int32_t r = poll(&pfd, 1, left);
+        if (r > 0) return true;
+        if (r < 0 && errno != EINTR) return false;
+    }
+}
+
+static bool control_recv(int32_t fd, char* buf, size_t len, gint64 deadline) {
+    while (len) {
+        if (!control_wait(fd, POLLIN, deadline)) return false;
+        ssize_t n = recv(fd, buf, len, MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+// one request and its response as a client, false when nobody listens
+// on the socket or the answer doesn't come in time
+bool ControlServer::request(const std::string& req, std::string *response, int32_t timeout_ms) {
+    std::string name = socket_path();
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (name.size() >= sizeof(addr.sun_path)) return false;
+    strncpy(addr.sun_path, name.c_str(), sizeof(addr.sun_path) - 1);
+    int32_t c = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (c < 0) return false;
+    if (connect(c, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(c);
+        return false;
+    }
+    gint64 deadline = g_get_monotonic_time() + (gint64)timeout_ms * 1000;
+    uint32_t len = req.size();
+    std::string frame(4, '\0');
+    frame[0] = len >> 24;
+    frame[1] = len >> 16;
+    frame[2] = len >> 8;
+    frame[3] = len;
+    frame += req;
+    bool ok = true;
+    for (size_t pos = 0; ok && pos < frame.size();) {
+        ssize_t n = send(c, frame.data() + pos, frame.size() - pos, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) pos += n;
+        else if (n < 0 && (errno == EAGAIN || errno == EINTR)) ok = control_wait(c, POLLOUT, deadline);
+        else ok = false;
+    }
+    unsigned char h[4];
+    ok = ok && control_recv(c, (char*)h, 4, deadline);
+    if (ok) {
+        len = ((uint32_t)h[0] << 24) | ((uint32_t)h[1] << 16) | ((uint32_t)h[2] << 8) | h[3];
+        ok = len <= CONTROL_MAX_FRAME;
+    }
+    if (ok) {
+        response->assign(len, '\0');
+        ok = control_recv(c, &(*response)[0], len, deadline);
+    }
+    close(c);
+    return ok;
+}
+
+// runs before GTK and lilv are initialized, the hand over only counts
+// once the running instance answered, a stale socket or a hung instance
+// lets this one start
+bool ControlServer::forward(const std::string& msg) {
+    TraceSpan span("handoff", msg);
+    std::string response;
+    if (!request(msg, &response, CONTROL_FORWARD_TIMEOUT)) return false;
+    if (response.compare(0, 3, "ok\n") != 0) fprintf(stderr, "jalv.select: %s", response.c_str());
+    return true;
+}
+
+ControlServer::ControlServer()
+    : fd(-1),
+    inode(0) {
+}
+
+ControlServer::~ControlServer() {
+    accept_io.disconnect();
+    while (!clients.empty()) close_client(clients.begin()->first);
+    if (fd < 0) return;
+    close(fd);
+    // a newer instance may have replaced the socket meanwhile
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && st.st_ino == inode) unlink(path.c_str());
+}
+
+bool ControlServer::open() {
+    path = socket_path();
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) return false;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "jalv.select: socket: %s\n", strerror(errno));
+        return false;
+    }
+    // only a socket nobody listens on was left behind, one in use
+    // belongs to another instance and stays its own
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 || errno == EINPROGRESS ||
+        errno == EAGAIN) {
+        fprintf(stderr, "jalv.select: %s is in use, no control socket\n", path.c_str());
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    if (errno == ECONNREFUSED) {
+        unlink(path.c_str());
+    } else if (errno != ENOENT) {
+        fprintf(stderr, "jalv.select: %s: %s\n", path.c_str(), strerror(errno));
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    close(fd);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "jalv.select: socket: %s\n", strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0
+      || chmod(path.c_str(), 0600) != 0 || stat(path.c_str(), &st) != 0) {
+        fprintf(stderr, "jalv.select: %s: %s\n", path.c_str(), strerror(errno));
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    inode = st.st_ino;
+    accept_io = Glib::signal_io().connect(
+      sigc::mem_fun(*this, &ControlServer::on_accept), fd, Glib::IO_IN);
+    return true;
+}
+
+bool ControlServer::on_accept(Glib::IOCondition condition) {
+    for (;;) {
+        int32_t c = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (c < 0) break;
+        ControlClient& client = clients[c];
+        client.fd = c;
+        client.eof = false;
+        client.condition = 0;
+        watch_client(client);
+    }
+    return true;
+}
+
+// reads until the client shuts down its side, waits for POLLOUT only
+// while there's something left to send
+void ControlServer::watch_client(ControlClient& client) {
+    Glib::IOCondition condition = Glib::IO_ERR;
+    if (!client.eof) condition |= Glib::IO_IN | Glib::IO_HUP;
+    if (!client.out.empty()) condition |= Glib::IO_OUT;
+    if (client.condition == (int32_t)condition) return;
+    client.condition = condition;
+    client.io.disconnect();
+    client.io = Glib::signal_io().connect(sigc::bind(
+      sigc::mem_fun(*this, &ControlServer::on_client_io), client.fd), client.fd, condition);
+}
+
+void ControlServer::close_client(int32_t client_fd) {
+    std::map<int32_t, ControlClient>::iterator it = clients.find(client_fd);
+    if (it == clients.end()) return;
+    it->second.io.disconnect();
+    close(client_fd);
+    clients.erase(it);
+}
+
+// false when the client is gone
+bool ControlServer::flush_client(ControlClient& client) {
+    while (!client.out.empty()) {
+        ssize_t n = send(client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+            return false;
+        }
+        client.out.erase(0, n);
+    }
+    return true;
+}
+
+bool ControlServer::on_client_io(Glib::IOCondition condition, int32_t client_fd) {
+    std::map<int32_t, ControlClient>::iterator it = clients.find(client_fd);
+    if (it == clients.end()) return false;
+    ControlClient& client = it->second;
+    if (condition & Glib::IO_ERR) {
+        close_client(client_fd);
+        return false;
+    }
+    if (!client.eof && (condition & (Glib::IO_IN | Glib::IO_HUP))) {
+        char buf[4096];
+        for (;;) {
+            ssize_t n = recv(client.fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                client.in.append(buf, n);
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                client.eof = true;
+                break;
+            }
+        }
+    }
+    // every complete frame of a batch is answered before anything is sent
+    size_t pos = 0;
+    while (client.in.size() - pos >= 4) {
+        const unsigned char* h = (const unsigned char*)client.in.data() + pos;
+        uint32_t len = ((uint32_t)h[0] << 24) | ((uint32_t)h[1] << 16) | ((uint32_t)h[2] << 8) | h[3];
+        if (len > CONTROL_MAX_FRAME) {
+            close_client(client_fd);
+            return false;
+        }
+        if (client.in.size() - pos - 4 < len) break;
+        std::string request = client.in.substr(pos + 4, len);
+        pos += 4 + len;
+        std::string response;
+        on_request(request, &response);
+        uint32_t rlen = response.size();
+        char header[4] = { (char)(rlen >> 24), (char)(rlen >> 16), (char)(rlen >> 8), (char)rlen };
+        client.out.append(header, 4);
+        client.out += response;
+    }
+    client.in.erase(0, pos);
+    if (!flush_client(client) || (client.eof && client.out.empty())) {
+        close_client(client_fd);
+        return false;
+    }
+    watch_client(client);
+    return true;
+}
+
+
+///*** ----------- Class Interpreters functions ----------- ***///
+
+// only these names are looked up in PATH, in the order they're offered,
+// all of them are jalv front-ends and take jalv's arguments
+static const char* interpreter_names[] = {
+    "jalv", "jalv.gtk", "jalv.gtk3", "jalv.gtkmm", "jalv.qt",
+    "jalv.qt4", "jalv.qt5", "jalv.qt6", NULL
+};
+
+Interpreters::Interpreters()
+    : key(0),
+      rescanned(false) {
+    cache_file = Glib::build_filename(Glib::get_user_cache_dir(), "jalv.select", "interpreters");
+}
+
+Interpreters::~Interpreters() {
+    if (scan_thread.joinable()) scan_thread.join();
+}
+
+// a binary added to or removed from a PATH directory changes its mtime
+uint64_t Interpreters::path_key() {
+    const char* path = getenv("PATH");
+    std::stringstream ss(path ? path : "");
+    std::string k;
+    for (std::string dir; getline(ss, dir, ':');) {
+        if (dir.empty()) continue;
+        k += dir + "=" + to_string(stat_mtime(dir)) + ":";
+    }
+    return hash_string(k);
+}
+
+// false when PATH is unset or none of its directories can be searched,
+// an empty list is a real result
+bool Interpreters::scan(std::vector<std::string> *found) {
+    std::set<std::string> seen;
+    const char* path = getenv("PATH");
+    if (!path) return false;
+    std::stringstream ss(path);
+    bool readable = false;
+    for (std::string dir; getline(ss, dir, ':');) {
+        if (dir.empty() || access(dir.c_str(), X_OK) != 0) continue;
+        readable = true;
+        for (const char** n = interpreter_names; *n; n++) {
+            if (access((dir + "/" + *n).c_str(), X_OK) == 0) seen.insert(*n);
+        }
+    }
+    if (!readable) return false;
+    found->clear();
+    for (const char** n = interpreter_names; *n; n++) {
+        if (!seen.count(*n)) continue;
+        // plain jalv needs a console
+        if (!strcmp(*n, "jalv")) found->push_back("jalv -s");
+        else found->push_back(*n);
+    }
+    return true;
+}
+
+// first line the key, then one interpreter per line
+bool Interpreters::read_cache() {
+    std::ifstream input(cache_file.c_str());
+    std::string line;
+    if (!getline(input, line)) return false;
+    key = strtoull(line.c_str(), NULL, 16);
+    names.clear();
+    while (getline(input, line)) {
+        if (!line.empty()) names.push_back(line);
+    }
+    return true;
+}
+
+void Interpreters::write_cache(uint64_t k, const std::vector<std::string>& found) {
+    g_mkdir_with_parents(Glib::path_get_dirname(cache_file).c_str(), 0755);
+    std::string tmp = cache_file + "." + to_string(getpid());
+    FILE* fp = fopen(tmp.c_str(), "w");
+    if (!fp) return;
+    bool ok = fprintf(fp, "%016llx\n", (unsigned long long)k) > 0;
+    for (std::vector<std::string>::const_iterator it = found.begin(); ok && it != found.end(); ++it) {
+        ok = fprintf(fp, "%s\n", it->c_str()) > 0;
+    }
+    if (fclose(fp) != 0) ok = false;
+    if (!ok || rename(tmp.c_str(), cache_file.c_str()) != 0) {
+        unlink(tmp.c_str());
+    }
+}
+
+// the cached list is trusted at startup, rescan() checks it later
+void Interpreters::load() {
+    if (read_cache()) return;
+    key = path_key();
+    if (scan(&names)) write_cache(key, names);
+}
+
+void Interpreters::rescan() {
+    if (scan_thread.joinable()) scan_thread.join();
+    scan_thread = std::thread(&Interpreters::run_rescan, this);
+}
+
+// runs in the scan thread
+void Interpreters::run_rescan() {
+    uint64_t k = path_key();
+    if (k == key) return;
+    std::vector<std::string> found;
+    // the cached list stays until PATH can be read again
+    if (!scan(&found)) return;
+    write_cache(k, found);
+    {
+        std::lock_guard<std::mutex> lock(scan_mutex);
+        scanned.swap(found);
+        rescanned = true;
+        key = k;
+    }
+    changed.emit();
+}
+
+// takes the result of the last rescan, true when the list changed
+bool Interpreters::update() {
+    if (scan_thread.joinable()) scan_thread.join();
+    std::lock_guard<std::mutex> lock(scan_mutex);
+    if (!rescanned) return false;
+    rescanned = false;
+    if (scanned == names) return false;
+    names.swap(scanned);
+    scanned.clear();
+    return true;
+}
+
+
+///*** ----------- Class SearchIndex functions ----------- ***///
+
+void SearchIndex::clear() {
+    keys.clear();
+    texts.clear();
+    key.clear();
+    text.clear();
+    postings.clear();
+}
+
+uint32_t SearchIndex::trigram(const char* p) {
+    return ((uint32_t)(unsigned char)p[0] << 16) |
+           ((uint32_t)(unsigned char)p[1] << 8) |
+            (uint32_t)(unsigned char)p[2];
+}
+
+// decompose, drop the combining marks and casefold, so "Délai" finds "delai"
+std::string SearchIndex::fold(const std::string& s) {
+    gchar* norm = g_utf8_normalize(s.c_str(), s.size(), G_NORMALIZE_ALL);
+    if (!norm) {
+        std::string ret = s;
+        for (std::string::iterator it = ret.begin(); it != ret.end(); ++it) {
+            *it = tolower((unsigned char)*it);
+        }
+        return ret;
+    }
+    std::string stripped;
+    stripped.reserve(s.size());
+    for (const gchar* p = norm; *p; p = g_utf8_next_char(p)) {
+        gunichar c = g_utf8_get_char(p);
+        GUnicodeType t = g_unichar_type(c);
+        if (t == G_UNICODE_NON_SPACING_MARK || t == G_UNICODE_SPACING_MARK ||
+            t == G_UNICODE_ENCLOSING_MARK) continue;
+        stripped.append(p, g_utf8_next_char(p) - p);
+    }
+    g_free(norm);
+    gchar* folded = g_utf8_casefold(stripped.c_str(), stripped.size());
+    std::string ret = folded;
+    g_free(folded);
+    return ret;
+}
+
+// ids must be added in ascending order, that keeps the postings sorted
+void SearchIndex::add(uint32_t id, const std::string& s) {
+    std::string f = fold(s);
+    if (key.size() <= id) {
+        key.resize(id + 1, 0);
+        text.resize(id + 1, 0);
+    }
+    key[id] = keys.size();
+    keys += f;
+    keys += '\0';
+    text[id] = texts.size();
+    texts += s;
+    texts += '\0';
+    for (size_t i = 0; i + 3 <= f.size(); i++) {
+        std::vector<uint32_t>& list = postings[trigram(f.data() + i)];
+        if (list.empty() || list.back() != id) list.push_back(id);
+    }
+}
+
+bool SearchIndex::is_regex(const Glib::ustring& query) {
+    return query.compare(0, 3, "re:") == 0;
+}
+
+// every match of query is a match of previous
+bool SearchIndex::narrows(const Glib::ustring& query, const Glib::ustring& previous) {
+    if (previous.empty() || is_regex(query) || is_regex(previous)) return false;
+    return fold(query).find(fold(previous)) != std::string::npos;
+}
+
+// keep the ids in result which match query
+void SearchIndex::filter(const Glib::ustring& query, std::vector<uint32_t> *result) const {
+    SearchPass pass;
+    pass.start(*this, query, result);
+    pass.step(result->size());
+    result->swap(pass.result);
+}
+
+static bool shorter(const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) {
+    return a->size() < b->size();
+}
+
+void SearchIndex::swap(SearchIndex& other) {
+    keys.swap(other.keys);
+    texts.swap(other.texts);
+    key.swap(other.key);
+    text.swap(other.text);
+    postings.swap(other.postings);
+}
+
+void SearchIndex::find(const Glib::ustring& query, std::vector<uint32_t> *result) const {
+    SearchPass pass;
+    pass.start(*this, query, NULL);
+    pass.step(size());
+    result->swap(pass.result);
+}
+
+// the ids which may match, a regex or a query too short for a trigram
+// has to look at all of them
+void SearchIndex::candidates(const Glib::ustring& query, std::vector<uint32_t> *ids) const {
+    ids->clear();
+    std::string q = fold(query);
+    if (is_regex(query) || q.size() < 3) {
+        ids->resize(key.size());
+        for (uint32_t id = 0; id < key.size(); id++) (*ids)[id] = id;
+        return;
+    }
+    std::vector<const std::vector<uint32_t>*> lists;
+    for (size_t i = 0; i + 3 <= q.size(); i++) {
+        std::unordered_map<uint32_t, std::vector<uint32_t> >::const_iterator it =
+          postings.find(trigram(q.data() + i));
+        if (it == postings.end()) return;
+        lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(), shorter);
+    *ids = *lists[0];
+    std::vector<uint32_t> tmp;
+    for (size_t i = 1; i < lists.size() && !ids->empty(); i++) {
+        tmp.clear();
+        std::set_intersection(ids->begin(), ids->end(),
+          lists[i]->begin(), lists[i]->end(), std::back_inserter(tmp));
+        ids->swap(tmp);
+    }
+}
+
+// the trigrams of a candidate match, the folded query has to be in its
+// key in one piece
+bool SearchIndex::match(uint32_t id, const std::string& folded,
+                        const Glib::RefPtr<Glib::Regex>& re) const {
+    if (re) return re->match(texts.data() + text[id]);
+    return strstr(keys.data() + key[id], folded.c_str()) != NULL;
+}
+
+
+///*** ----------- Class SearchPass functions ----------- ***///
+
+// within is the result of a search this one narrows, NULL for the whole index
+void SearchPass::start(const SearchIndex& i, const Glib::ustring& query,
+                       const std::vector<uint32_t>* within) {
+    index = &i;
+    indexed = i.size();
+    pos = 0;
+    result.clear();
+    re.reset();
+    folded = SearchIndex::fold(query);
+    if (SearchIndex::is_regex(query)) {
+        try {
+            re = Glib::Regex::create(query.substr(3),
+              Glib::REGEX_CASELESS | Glib::REGEX_OPTIMIZE);
+        } catch (Glib::RegexError& error) {
+            ids.clear();
+            return;
+        }
+    }
+    if (within) ids = *within;
+    else i.candidates(query, &ids);
+}
+
+// looks at the next n candidates, true once all of them are done
+bool SearchPass::step(size_t n) {
+    size_t end = std::min(pos + n, ids.size());
+    for (; pos < end; pos++) {
+        if (ids[pos] < indexed && index->match(ids[pos], folded, re)) result.push_back(ids[pos]);
+    }
+    return pos >= ids.size();
+}
+
+
+///*** ----------- Class Bitset functions ----------- ***///
+
+Bitset::Bitset() : bits(0) {
+}
+
+Bitset::~Bitset() {
+}
+
+void Bitset::set(size_t i, bool value) {
+    if (i >= bits) return;
+    if (value) words[i >> 6] |= uint64_t(1) << (i & 63);
+    else words[i >> 6] &= ~(uint64_t(1) << (i & 63));
+}
+
+// new bits are cleared
+void Bitset::resize(size_t n) {
+    words.resize((n + 63) >> 6, 0);
+    if (n < bits && (n & 63)) words.back() &= (uint64_t(1) << (n & 63)) - 1;
+    bits = n;
+}
+
+size_t Bitset::count() const {
+    size_t n = 0;
+    for (std::vector<uint64_t>::const_iterator it = words.begin(); it != words.end(); ++it) {
+        n += __builtin_popcountll(*it);
+    }
+    return n;
+}
+
+void Bitset::clear() {
+    words.clear();
+    bits = 0;
+}
+
+void Bitset::fill() {
+    for (std::vector<uint64_t>::iterator it = words.begin(); it != words.end(); ++it) {
+        *it = ~uint64_t(0);
+    }
+    if (bits & 63) words.back() = (uint64_t(1) << (bits & 63)) - 1;
+}
+
+// bits past the end of other count as cleared
+void Bitset::and_with(const Bitset& other) {
+    size_t n = std::min(words.size(), other.words.size());
+    for (size_t w = 0; w < n; w++) words[w] &= other.words[w];
+    for (size_t w = n; w < words.size(); w++) words[w] = 0;
+}
+
+void Bitset::and_not(const Bitset& other) {
+    size_t n = std::min(words.size(), other.words.size());
+    for (size_t w = 0; w < n; w++) words[w] &= ~other.words[w];
+}
+
+void Bitset::assign(size_t n, const std::vector<uint32_t>& indices) {
+    words.assign((n + 63) >> 6, 0);
+    bits = n;
+    for (std::vector<uint32_t>::const_iterator it = indices.begin(); it != indices.end(); ++it) {
+        set(*it, true);
+    }
+}
+
+// ascending, one step per set bit
+void Bitset::get_indices(std::vector<uint32_t> *indices) const {
+    indices->clear();
+    for (size_t w = 0; w < words.size(); w++) {
+        for (uint64_t word = words[w]; word; word &= word - 1) {
+            indices->push_back((w << 6) + __builtin_ctzll(word));
+        }
+    }
+}
+
+
+///*** ----------- Class ViewFilter functions ----------- ***///
+
+void ViewFilter::apply(size_t n, Bitset *view) const {
+    view->clear();
+    view->resize(n);
+    view->fill();
+    for (std::vector<const Bitset*>::const_iterator it = required.begin(); it != required.end(); ++it) {
+        view->and_with(**it);
+    }
+    for (std::vector<const Bitset*>::const_iterator it = excluded.begin(); it != excluded.end(); ++it) {
+        view->and_not(**it);
+    }
+}
+
+// the view of the plugin list, a NULL bitset is a filter which is off.
+// The list and --bench both go through here.
+static void compose_view(const PluginTable& table, const Bitset& fav_bits, const Bitset& bl_bits,
+                         bool favs, bool bls, const Bitset* text_bits,
+                         const Bitset* port_bits, const Bitset* class_bits, Bitset* view) {
+    ViewFilter filter;
+    filter.exclude(table.removed);
+    if (favs) filter.require(fav_bits);
+    if (bls) filter.require(bl_bits);
+    else filter.exclude(bl_bits);
+    if (text_bits) filter.require(*text_bits);
+    if (port_bits) filter.require(*port_bits);
+    if (class_bits) filter.require(*class_bits);
+    filter.apply(table.size(), view);
+}
+
+// the rows of a view in the given order
+static void view_rows(const std::vector<uint32_t>& order, const Bitset& view,
+                      std::vector<uint32_t>* rows) {
+    rows->clear();
+    rows->reserve(view.count());
+    for (std::vector<uint32_t>::const_iterator it = order.begin(); it != order.end(); ++it) {
+        if (view.test(*it)) rows->push_back(*it);
+    }
+}
+
+///*** ----------- Class PluginTable functions ----------- ***///
+
+PluginTable::PluginTable() {
+}
+
+PluginTable::~PluginTable() {
+}
+
+void PluginTable::clear() {
+    pool.clear();
+    shared.clear();
+    uri.clear();
+    name.clear();
+    short_name.clear();
+    name_key.clear();
+    cls_key.clear();
+    author_key.clear();
+    keys.clear();
+    cls.clear();
+    cls_uri.clear();
+    author.clear();
+    search.clear();
+    audio_in.clear();
+    audio_out.clear();
+    midi_in.clear();
+    midi_out.clear();
+    control_in.clear();
+    control_out.clear();
+    cv_in.clear();
+    cv_out.clear();
+    required.clear();
+    latency.clear();
+    hard_rt.clear();
+    tooltip.clear();
+    invalid.clear();
+    removed.clear();
+    ids.clear();
+}
+
+uint32_t PluginTable::add_string(const std::string& s) {
+    uint32_t off = pool.size();
+    pool += s;
+    pool += '\0';
+    return off;
+}
+
+// class labels and authors repeat a lot, store them once
+uint32_t PluginTable::add_shared(const std::string& s) {
+    std::map<std::string, uint32_t>::iterator it = shared.find(s);
+    if (it != shared.end()) return it->second;
+    uint32_t off = add_string(s);
+    shared[s] = off;
+    return off;
+}
+
+// the sort key of a pool string, computed once per distinct string
+uint32_t PluginTable::add_key(uint32_t off) {
+    std::unordered_map<uint32_t, uint32_t>::iterator it = keys.find(off);
+    if (it != keys.end()) return it->second;
+    gchar* key = g_utf8_collate_key(get(off), -1);
+    uint32_t key_off = add_string(key);
+    g_free(key);
+    keys[off] = key_off;
+    return key_off;
+}
+
+void PluginTable::truncate_name(std::string *name) {
+    if (name->size() > 25) {
+        size_t rem = name->find(" - ");
+        if(rem != std::string::npos) {
+            name->erase(rem);
+        }
+    }    
+}
 
-///*** ----------- Class Options functions ----------- ***///
+void PluginTable::swap(PluginTable& other) {
+    pool.swap(other.pool);
+    shared.swap(other.shared);
+    uri.swap(other.uri);
+    name.swap(other.name);
+    short_name.swap(other.short_name);
+    name_key.swap(other.name_key);
+    cls_key.swap(other.cls_key);
+    author_key.swap(other.author_key);
+    keys.swap(other.keys);
+    cls.swap(other.cls);
+    cls_uri.swap(other.cls_uri);
+    author.swap(other.author);
+    audio_in.swap(other.audio_in);
+    audio_out.swap(other.audio_out);
+    midi_in.swap(other.midi_in);
+    midi_out.swap(other.midi_out);
+    control_in.swap(other.control_in);
+    control_out.swap(other.control_out);
+    cv_in.swap(other.cv_in);
+    cv_out.swap(other.cv_out);
+    required.swap(other.required);
+    latency.swap(other.latency);
+    hard_rt.swap(other.hard_rt);
+    tooltip.swap(other.tooltip);
+    invalid.swap(other.invalid);
+    removed.swap(other.removed);
+    ids.swap(other.ids);
+    search.swap(other.search);
+}
 
-Options::Options() :
-    o_group("",""),
-    hidden(false),
-    version(false),
-    w_high(0) {
-        opt_hide.set_short_name('s');
-        opt_hide.set_long_name("systray");
-        opt_hide.set_description(_("start minimized in systray"));
+// returns false for plugins which can't be listed
+bool PluginTable::append(const CatalogRecord& rec) {
+    if (!rec.valid) {
+        if (std::find(invalid.begin(), invalid.end(), rec.uri) == invalid.end()) {
+            invalid.push_back(rec.uri);
+        }
+        return false;
+    }
+    std::string sname = rec.name;
+    truncate_name(&sname);
+    if (sname.empty()) sname = rec.name;
+    uri.push_back(add_string(rec.uri));
+    name.push_back(add_string(rec.name));
+    short_name.push_back(sname == rec.name ? name.back() : add_string(sname));
+    cls.push_back(add_shared(rec.cls));
+    cls_uri.push_back(add_shared(rec.cls_uri));
+    author.push_back(add_shared(rec.author));
+    name_key.push_back(add_key(short_name.back()));
+    cls_key.push_back(add_key(cls.back()));
+    author_key.push_back(add_key(author.back()));
+    search.add(uri.size() - 1, rec.name + rec.cls + rec.uri);
+    audio_in.push_back(rec.audio_in);
+    audio_out.push_back(rec.audio_out);
+    midi_in.push_back(rec.midi_in);
+    midi_out.push_back(rec.midi_out);
+    control_in.push_back(rec.control_in);
+    control_out.push_back(rec.control_out);
+    cv_in.push_back(rec.cv_in);
+    cv_out.push_back(rec.cv_out);
+    required.push_back(add_shared(rec.required));
+    latency.resize(uri.size());
+    latency.set(uri.size() - 1, rec.latency);
+    hard_rt.resize(uri.size());
+    hard_rt.set(uri.size() - 1, rec.hard_rt);
 
-        opt_size.set_short_name('H');
-        opt_size.set_long_name("high");
-        opt_size.set_description(_("start with given high in pixel"));
-        opt_size.set_arg_description("HIGH");
+    tooltip.push_back(Glib::ustring());
+    removed.resize(uri.size());
+    ids[rec.uri] = uri.size() - 1;
+    return true;
+}
 
-        opt_version.set_short_name('v');
-        opt_version.set_long_name("version");
-        opt_version.set_description(_("print version string and exit"));
+int32_t PluginTable::find(const std::string& u) const {
+    std::unordered_map<std::string, uint32_t>::const_iterator it = ids.find(u);
+    if (it == ids.end()) return -1;
+    return it->second;
+}
 
-        o_group.add_entry(opt_hide, hidden);
-        o_group.add_entry(opt_size, w_high);
-        o_group.add_entry(opt_version, version);
-        set_main_group(o_group);
+// the row stays, so the indices of the others don't change
+void PluginTable::remove(const std::string& u) {
+    std::unordered_map<std::string, uint32_t>::iterator it = ids.find(u);
+    if (it == ids.end()) return;
+    removed.set(it->second, true);
+    ids.erase(it);
+}
+
+// tooltips are only needed for the row under the mouse, build them on demand
+const Glib::ustring& PluginTable::get_tooltip(size_t i) {
+    Glib::ustring& tip = tooltip[i];
+    if (!tip.empty()) return tip;
+    tip = get(cls[i]);
+    if (*get(author[i])) {
+        tip += _(" \nby ");
+        tip += get(author[i]);
+    }
+    if(audio_in[i] !=0) {
+        tip += _("\nAudio Inputs: ") ;
+        tip += to_string(audio_in[i]);
+    }
+    if(audio_out[i] !=0) {
+        tip += _("\nAudio Outputs: ") ;
+        tip += to_string(audio_out[i]);
+    }
+    if(midi_in[i] !=0) {
+        tip += _("\nMidi Inputs: ") ;
+        tip += to_string(midi_in[i]);
     }
+    if(midi_out[i] !=0) {
+        tip += _("\nMidi Outputs: ") ;
+        tip += to_string(midi_out[i]);
+    }
+    if(cv_in[i] !=0) {
+        tip += _("\nCV Inputs: ") ;
+        tip += to_string(cv_in[i]);
+    }
+    if(cv_out[i] !=0) {
+        tip += _("\nCV Outputs: ") ;
+        tip += to_string(cv_out[i]);
+    }
+    if (latency.test(i)) tip += _("\nReports latency");
+    if (hard_rt.test(i)) tip += _("\nHard real-time capable");
+    if (tip.empty()) tip = " ";
+    return tip;
+}
 
-Options::~Options() {}
 
-void Options::show_version_and_exit(LV2PluginList *p) {
-    fprintf(stderr, "jalv.select version \033[1;32m %s \n \033[0m" 
-      "    Public Domain @ 2019 by Hermman Meyer\n", VERSION );
-    p->hide();
-    Glib::signal_idle().connect_once(
-      sigc::ptr_fun ( Gtk::Main::quit));
+///*** ----------- Class PortQuery functions ----------- ***///
+
+struct PortToken {
+    const char* name;
+    PortField field;
+};
+
+// tokens with a count, "ain:2" or "ain:2+" for at least two
+static const PortToken port_counts[] = {
+    { "ain", PORT_AUDIO_IN },
+    { "aout", PORT_AUDIO_OUT },
+    { "cin", PORT_CONTROL_IN },
+    { "cout", PORT_CONTROL_OUT },
+    { "cvin", PORT_CV_IN },
+    { "cvout", PORT_CV_OUT },
+    { "min", PORT_MIDI_IN },
+    { "mout", PORT_MIDI_OUT },
+    { NULL, PORT_AUDIO_IN }
+};
+
+// tokens which need at least one
+static const PortToken port_flags[] = {
+    { "midi:in", PORT_MIDI_IN },
+    { "midi:out", PORT_MIDI_OUT },
+    { "cv", PORT_CV },
+    { "cv:in", PORT_CV_IN },
+    { "cv:out", PORT_CV_OUT },
+    { "latency", PORT_LATENCY },
+    { "rt", PORT_HARD_RT },
+    { NULL, PORT_AUDIO_IN }
+};
+
+bool PortQuery::parse_token(const std::string& token, PortTerm *term) {
+    term->count = 1;
+    term->at_least = true;
+    for (const PortToken* t = port_flags; t->name; t++) {
+        if (token != t->name) continue;
+        term->field = t->field;
+        return true;
+    }
+    // "req:none" or a part of a required feature URI, like "req:urid#map"
+    if (token.compare(0, 4, "req:") == 0 && token.size() > 4) {
+        term->text = token.substr(4);
+        term->field = PORT_FEATURE;
+        if (term->text == "none") {
+            term->field = PORT_FEATURES;
+            term->count = 0;
+            term->at_least = false;
+        }
+        return true;
+    }
+    size_t colon = token.find(':');
+    if (colon == std::string::npos || colon + 1 == token.size()) return false;
+    for (const PortToken* t = port_counts; t->name; t++) {
+        if (token.compare(0, colon, t->name) != 0 || strlen(t->name) != colon) continue;
+        const char* num = token.c_str() + colon + 1;
+        char* end = NULL;
+        unsigned long n = strtoul(num, &end, 10);
+        if (end == num || (*end && strcmp(end, "+") != 0) || n > 0xffff) return false;
+        term->field = t->field;
+        term->count = n;
+        term->at_least = *end == '+';
+        return true;
+    }
+    return false;
 }
 
+// the port tokens go into the terms, the other words are left for the
+// text search, a regular expression is left alone
+void PortQuery::parse(const std::string& text, std::string *rest) {
+    terms.clear();
+    if (SearchIndex::is_regex(text)) {
+        *rest = text;
+        return;
+    }
+    rest->clear();
+    std::stringstream ss(text);
+    std::string token;
+    while (ss >> token) {
+        PortTerm term;
+        if (parse_token(token, &term)) {
+            terms.push_back(term);
+            continue;
+        }
+        if (!rest->empty()) *rest += " ";
+        *rest += token;
+    }
+}
 
-///*** ----------- Class PresetList functions ----------- ***///
+uint32_t PortQuery::value(const PluginTable& table, size_t i, const PortTerm& term) {
+    switch (term.field) {
+    case PORT_AUDIO_IN: return table.audio_in[i];
+    case PORT_AUDIO_OUT: return table.audio_out[i];
+    case PORT_CONTROL_IN: return table.control_in[i];
+    case PORT_CONTROL_OUT: return table.control_out[i];
+    case PORT_CV_IN: return table.cv_in[i];
+    case PORT_CV_OUT: return table.cv_out[i];
+    case PORT_CV: return table.cv_in[i] + table.cv_out[i];
+    case PORT_MIDI_IN: return table.midi_in[i];
+    case PORT_MIDI_OUT: return table.midi_out[i];
+    case PORT_LATENCY: return table.latency.test(i);
+    case PORT_HARD_RT: return table.hard_rt.test(i);
+    case PORT_FEATURES: return *table.get(table.required[i]) != 0;
+    case PORT_FEATURE: return strstr(table.get(table.required[i]), term.text.c_str()) != NULL;
+    }
+    return 0;
+}
 
-PresetList::PresetList() {
-    presetStore = Gtk::ListStore::create(psets);
-    presetStore->set_sort_column(psets.col_label, Gtk::SORT_ASCENDING); 
+// a plugin matches when it matches every term
+void PortQuery::apply(const PluginTable& table, Bitset *result) const {
+    result->clear();
+    result->resize(table.size());
+    result->fill();
+    for (std::vector<PortTerm>::const_iterator t = terms.begin(); t != terms.end(); ++t) {
+        for (size_t i = 0; i < table.size(); i++) {
+            uint32_t v = value(table, i, *t);
+            if (t->at_least ? v < t->count : v != t->count) result->set(i, false);
+        }
+    }
 }
 
-PresetList::~PresetList() { 
-    free(uris);
+
+///*** ----------- Class PluginModel functions ----------- ***///
+
+PluginModel::PluginModel(const PluginTable& t, const Bitset& f, const Bitset& b,
+                         const std::vector<gint64>& u) :
+    Glib::ObjectBase(typeid(PluginModel)),
+    Glib::Object(),
+    table(t),
+    favs(f),
+    bls(b),
+    gap_at(0),
+    gap_len(0),
+    stamp(1) {
+    less.table = &t;
+    less.last_used = &u;
+    less.order = SORT_NAME;
+}
+
+PluginModel::~PluginModel() {
+}
+
+Glib::RefPtr<PluginModel> PluginModel::create(const PluginTable& t, const Bitset& f, const Bitset& b,
+                                              const std::vector<gint64>& u) {
+    return Glib::RefPtr<PluginModel>(new PluginModel(t, f, b, u));
+}
+
+// collation keys compare like g_utf8_collate() on the strings
+bool RowLess::operator()(uint32_t a, uint32_t b) const {
+    int c = 0;
+    switch (order) {
+    case SORT_CLASS:
+        c = strcmp(table->get(table->cls_key[a]), table->get(table->cls_key[b]));
+        break;
+    case SORT_AUTHOR:
+        c = strcmp(table->get(table->author_key[a]), table->get(table->author_key[b]));
+        break;
+    case SORT_RECENT: {
+        gint64 ua = a < last_used->size() ? (*last_used)[a] : 0;
+        gint64 ub = b < last_used->size() ? (*last_used)[b] : 0;
+        if (ua != ub) return ua > ub;
+        break;
+    }
+    default:
+        break;
+    }
+    if (!c) c = strcmp(table->get(table->name_key[a]), table->get(table->name_key[b]));
+    if (c) return c < 0;
+    return a < b;
+}
+
+// every table row in the given order
+static void sort_rows(const PluginTable& table, const std::vector<gint64>& last_used,
+                      SortOrder o, std::vector<uint32_t>* order) {
+    order->resize(table.size());
+    for (size_t i = 0; i < order->size(); i++) (*order)[i] = i;
+    RowLess less = { &table, &last_used, o };
+    std::sort(order->begin(), order->end(), less);
 }
 
-char** PresetList::uris = NULL;
-off_t PresetList::n_uris = 0;
+// an iter is a row position, any change of the rows invalidates it
+bool PluginModel::make_iter(size_t pos, iterator& iter) const {
+    if (pos >= size()) {
+        iter = iterator();
+        return false;
+    }
+    iter.set_stamp(stamp);
+    iter.gobj()->user_data = GUINT_TO_POINTER(pos);
+    return true;
+}
+
+size_t PluginModel::row_pos(const iterator& iter) const {
+    if (iter.get_stamp() != stamp) return size();
+    return GPOINTER_TO_UINT(iter.gobj()->user_data);
+}
+
+int32_t PluginModel::get_index(const iterator& iter) const {
+    size_t pos = row_pos(iter);
+    if (pos >= size()) return -1;
+    return row_at(pos);
+}
+
+// a filter switch or a new sort order only sends the difference to the
+// attached view: the rows which went away, one reorder of the rows which
+// stayed and the new ones, so it keeps its cursor, selection and scroll
+// position. Both passes move the rows through a gap in the vector, which
+// keeps the model consistent at every signal.
+void PluginModel::set_rows(const std::vector<uint32_t>& r) {
+    std::vector<int32_t> new_pos(table.size(), -1);
+    for (size_t j = 0; j < r.size(); j++) {
+        if (r[j] < new_pos.size()) new_pos[r[j]] = j;
+    }
+    size_t old_n = rows.size();
+    gap_at = 0;
+    gap_len = 0;
+    for (size_t i = 0; i < old_n; i++) {
+        uint32_t row = rows[i];
+        if (row < new_pos.size() && new_pos[row] >= 0) {
+            rows[gap_at++] = row;
+            continue;
+        }
+        gap_len++;
+        stamp++;
+        Path path;
+        path.push_back(gap_at);
+        row_deleted(path);
+    }
+    rows.resize(gap_at);
+    gap_at = 0;
+    gap_len = 0;
+
+    std::vector<int32_t> old_pos(new_pos.size(), -1);
+    for (size_t i = 0; i < rows.size(); i++) old_pos[rows[i]] = i;
+    std::vector<int> order;
+    order.reserve(rows.size());
+    bool moved = false;
+    for (size_t j = 0; j < r.size(); j++) {
+        if (r[j] >= old_pos.size() || old_pos[r[j]] < 0) continue;
+        if (old_pos[r[j]] != (int)order.size()) moved = true;
+        order.push_back(old_pos[r[j]]);
+    }
+    if (moved) {
+        std::vector<uint32_t> old(rows);
+        for (size_t k = 0; k < order.size(); k++) rows[k] = old[order[k]];
+        stamp++;
+        rows_reordered(Path(), order);
+    }
 
-LV2_URID PresetList::map_uri(LV2_URID_Map_Handle handle, const char* uri) {
-    for (off_t i = 0; i < n_uris; ++i) {
-        if (!strcmp(uris[i], uri)) {
-            return i + 1;
+    size_t kept = rows.size();
+    rows.resize(r.size());
+    std::copy_backward(rows.begin(), rows.begin() + kept, rows.end());
+    gap_len = r.size() - kept;
+    iterator iter;
+    for (size_t j = 0; j < r.size(); j++) {
+        if (r[j] < old_pos.size() && old_pos[r[j]] >= 0) {
+            rows[gap_at] = rows[gap_at + gap_len];
+            gap_at++;
+            continue;
         }
+        rows[gap_at++] = r[j];
+        gap_len--;
+        stamp++;
+        make_iter(j, iter);
+        Path path;
+        path.push_back(j);
+        row_inserted(path, iter);
     }
+    gap_at = 0;
+    gap_len = 0;
+}
 
-    uris = (char**)realloc(uris, ++n_uris * sizeof(char*));
-    uris[n_uris - 1] = const_cast<char*>(uri);
-    return n_uris;
+void PluginModel::insert_row(uint32_t i) {
+    size_t pos = std::upper_bound(rows.begin(), rows.end(), i, less) - rows.begin();
+    rows.insert(rows.begin() + pos, i);
+    stamp++;
+    iterator iter;
+    make_iter(pos, iter);
+    Path path;
+    path.push_back(pos);
+    row_inserted(path, iter);
 }
 
-const char* PresetList::unmap_uri(LV2_URID_Map_Handle handle, LV2_URID urid) {
-    if (urid > 0 && urid <= n_uris) {
-        return uris[urid - 1];
+void PluginModel::remove_rows(const std::set<int>& gone) {
+    for (size_t pos = rows.size(); pos-- > 0;) {
+        if (!gone.count(rows[pos])) continue;
+        rows.erase(rows.begin() + pos);
+        stamp++;
+        Path path;
+        path.push_back(pos);
+        row_deleted(path);
     }
-    return NULL;
 }
 
-int32_t PresetList::write_state_to_file(Glib::ustring state) {
-    Glib::RefPtr<Gio::File> file = Gio::File::create_for_path("/tmp/state.ttl");
-    if (file) {
-        Glib::ustring prefix = "@prefix atom: <http://lv2plug.in/ns/ext/atom#> .\n"
-                               "@prefix lv2: <http://lv2plug.in/ns/lv2core#> .\n"
-                               "@prefix pset: <http://lv2plug.in/ns/ext/presets#> .\n"
-                               "@prefix rdf: <http://www.w3.org/1999/02/22-rdf-syntax-ns#> .\n"
-                               "@prefix rdfs: <http://www.w3.org/2000/01/rdf-schema#> .\n"
-                               "@prefix state: <http://lv2plug.in/ns/ext/state#> .\n"
-                               "@prefix xsd: <http://www.w3.org/2001/XMLSchema#> .\n";
-        prefix +=   state;
-        Glib::RefPtr<Gio::DataOutputStream> out = Gio::DataOutputStream::create(file->replace());
-        out->put_string(prefix);
-        return 1;
+// the fav and blacklist columns read the bits, a toggle only needs a redraw
+void PluginModel::update_row(const Path& path) {
+    iterator iter;
+    if (!get_iter_vfunc(path, iter)) return;
+    row_changed(path, iter);
+}
+
+void PluginModel::clear() {
+    while (!rows.empty()) {
+        rows.pop_back();
+        stamp++;
+        Path path;
+        path.push_back(rows.size());
+        row_deleted(path);
+    }
+}
+
+Gtk::TreeModelFlags PluginModel::get_flags_vfunc() const {
+    return Gtk::TREE_MODEL_LIST_ONLY;
+}
+
+int PluginModel::get_n_columns_vfunc() const {
+    return columns.size();
+}
+
+GType PluginModel::get_column_type_vfunc(int index) const {
+    if (index < 0 || (unsigned)index >= columns.size()) return G_TYPE_INVALID;
+    return columns.types()[index];
+}
+
+// the strings stay in the table pool, the cell renderers copy them
+void PluginModel::get_value_vfunc(const iterator& iter, int column, Glib::ValueBase& value) const {
+    size_t pos = row_pos(iter);
+    if (pos >= size() || row_at(pos) >= table.size()) return;
+    if (column < 0 || (unsigned)column >= columns.size()) return;
+    uint32_t i = row_at(pos);
+    value.init(columns.types()[column]);
+    if (column == columns.col_id.index()) {
+        g_value_set_static_string(value.gobj(), table.get(table.uri[i]));
+    } else if (column == columns.col_name.index()) {
+        g_value_set_static_string(value.gobj(), table.get(table.short_name[i]));
+    } else if (column == columns.col_idx.index()) {
+        g_value_set_int(value.gobj(), i);
+    } else if (column == columns.col_fav.index()) {
+        g_value_set_boolean(value.gobj(), favs.test(i));
+    } else if (column == columns.col_bl.index()) {
+        g_value_set_boolean(value.gobj(), bls.test(i));
+    }
+}
+
+bool PluginModel::iter_next_vfunc(const iterator& iter, iterator& iter_next) const {
+    size_t pos = row_pos(iter);
+    if (pos >= size()) {
+        iter_next = iterator();
+        return false;
     }
+    return make_iter(pos + 1, iter_next);
+}
+
+bool PluginModel::iter_children_vfunc(const iterator& parent, iterator& iter) const {
+    iter = iterator();
+    return false;
+}
+
+bool PluginModel::iter_has_child_vfunc(const iterator& iter) const {
+    return false;
+}
+
+int PluginModel::iter_n_children_vfunc(const iterator& iter) const {
     return 0;
+}
 
+int PluginModel::iter_n_root_children_vfunc() const {
+    return size();
 }
 
-void PresetList::on_preset_selected(Gtk::Menu *presetMenu, Glib::ustring id, Gtk::TreeModel::iterator iter, LilvWorld* world) {
-    Gtk::TreeModel::Row row = *iter;
-   /* LV2_URID_Map       map           = { NULL, map_uri };
-    LV2_URID_Unmap     unmap         = { NULL, unmap_uri };
-
-    LilvNode* preset = lilv_new_uri(world, row.get_value(psets.col_uri).c_str());
-
-    LilvState* state = lilv_state_new_from_world(world, &map, preset);
-    lilv_state_set_label(state, row.get_value(psets.col_label).c_str());
-    Glib::ustring st = lilv_state_to_string(world,&map,&unmap,state,row.get_value(psets.col_uri).c_str(),NULL);
-    lilv_node_free(preset);
-    lilv_state_free(state);
-    st.replace(st.find_first_of("<"),st.find_first_of(">"),"<");
-    if(!write_state_to_file(st)) return;*/
-   
-    Gtk::TreeModel::iterator it = selection->get_selected();
-    if(iter) selection->unselect(*it);
-    Glib::ustring pre = row.get_value(psets.col_uri);
-    Glib::ustring com = interpret + " -p " + pre + id;
-    //Glib::ustring com = interpret + " -l " + "/tmp/state.ttl" + id;
-    //fprintf(stderr,"%s\n",com.c_str());
-    if (system(NULL)) system( com.c_str());
-    presetStore->clear();
-    delete presetMenu;
+bool PluginModel::iter_nth_child_vfunc(const iterator& parent, int n, iterator& iter) const {
+    iter = iterator();
+    return false;
 }
 
-void PresetList::on_preset_default(Gtk::Menu *presetMenu, Glib::ustring id) {
-    Gtk::TreeModel::iterator iter = selection->get_selected();
-    if(iter) selection->unselect(*iter);
-    Glib::ustring com = interpret + id;
-    if (system(NULL)) system( com.c_str());
-    presetStore->clear();
-    delete presetMenu;
+bool PluginModel::iter_nth_root_child_vfunc(int n, iterator& iter) const {
+    if (n < 0) {
+        iter = iterator();
+        return false;
+    }
+    return make_iter(n, iter);
 }
 
-void PresetList::on_preset_key(GdkEventKey *ev,Gtk::Menu *presetMenu) {
-    if (ev->keyval == 0xff1b) { // GDK_KEY_Escape
-        presetStore->clear();
-        delete presetMenu;
+bool PluginModel::iter_parent_vfunc(const iterator& child, iterator& iter) const {
+    iter = iterator();
+    return false;
+}
+
+Gtk::TreeModel::Path PluginModel::get_path_vfunc(const iterator& iter) const {
+    Path path;
+    size_t pos = row_pos(iter);
+    if (pos < size()) path.push_back(pos);
+    return path;
+}
+
+bool PluginModel::get_iter_vfunc(const Path& path, iterator& iter) const {
+    if (path.size() != 1 || path[0] < 0) {
+        iter = iterator();
+        return false;
     }
+    return make_iter(path[0], iter);
 }
 
-void PresetList::create_preset_menu(Glib::ustring id, LilvWorld* world) {
-    Gtk::MenuItem* item;
-    Gtk::Menu *presetMenu = Gtk::manage(new Gtk::Menu());
-    presetMenu->signal_key_release_event().connect_notify(
-          sigc::bind(sigc::mem_fun(
-          *this, &PresetList::on_preset_key),presetMenu));
-    item = Gtk::manage(new Gtk::MenuItem(_("Default"), true));
-    item->signal_activate().connect_notify(
-          sigc::bind(sigc::bind(sigc::mem_fun(
-          *this, &PresetList::on_preset_default),id),presetMenu));
-    presetMenu->append(*item);
-    if (presetStore->children().end() != presetStore->children().begin()) {
-        Gtk::SeparatorMenuItem *hline = Gtk::manage(new Gtk::SeparatorMenuItem());
-        presetMenu->append(*hline);
-        for (Gtk::TreeModel::iterator i = presetStore->children().begin();
-                                  i != presetStore->children().end(); i++) {
-            Gtk::TreeModel::Row row = *i; 
-            item = Gtk::manage(new Gtk::MenuItem(row[psets.col_label], true));
-            item->signal_activate().connect(
-              sigc::bind(sigc::bind(sigc::bind(sigc::bind(sigc::mem_fun(
-              *this, &PresetList::on_preset_selected),world),i),id),presetMenu));
-            presetMenu->append(*item);
-            
-        }
+
+///*** ----------- headless mode ----------- ***///
+
+// tabs and newlines would break a TSV line
+static std::string tsv_field(const char* s) {
+    std::string r = s;
+    std::replace(r.begin(), r.end(), '\t', ' ');
+    std::replace(r.begin(), r.end(), '\n', ' ');
+    return r;
+}
+
+// uri, name, class, author, audio in/out, midi in/out
+static std::string plugin_tsv(const PluginTable& table, size_t i) {
+    char ports[64];
+    snprintf(ports, sizeof(ports), "\t%i\t%i\t%i\t%i\n",
+             table.audio_in[i], table.audio_out[i], table.midi_in[i], table.midi_out[i]);
+    std::string line = table.get(table.uri[i]);
+    line += "\t" + tsv_field(table.get(table.name[i]));
+    line += "\t" + tsv_field(table.get(table.cls[i]));
+    line += "\t" + tsv_field(table.get(table.author[i]));
+    return line + ports;
+}
+
+// a search as typed into the search box, port tokens included
+static void find_plugins(const PluginTable& table, const std::string& text,
+                         std::vector<uint32_t> *result) {
+    PortQuery ports;
+    std::string rest;
+    ports.parse(text, &rest);
+    table.search.find(rest, result);
+    if (ports.empty()) return;
+    Bitset matched;
+    ports.apply(table, &matched);
+    size_t n = 0;
+    for (std::vector<uint32_t>::iterator it = result->begin(); it != result->end(); ++it) {
+        if (matched.test(*it)) (*result)[n++] = *it;
     }
-    presetMenu->show_all();
-    presetMenu->popup(0,gtk_get_current_event_time());
+    result->resize(n);
 }
 
-void PresetList::create_preset_list(Glib::ustring id, const LilvPlugin* plug, LilvWorld* world) {
-    LilvNodes* presets = lilv_plugin_get_related(plug,
-      lilv_new_uri(world,LV2_PRESETS__Preset));
-    presetStore->clear();
-    LILV_FOREACH(nodes, i, presets) {
-        const LilvNode* preset = lilv_nodes_get(presets, i);
-        lilv_world_load_resource(world, preset);
-        LilvNodes* labels = lilv_world_find_nodes(
-          world, preset, lilv_new_uri(world, LILV_NS_RDFS "label"), NULL);
-        if (labels) {
-            const LilvNode* label = lilv_nodes_get_first(labels);
-            Glib::ustring set =  lilv_node_as_string(label);
-            row = *(presetStore->append());
-            row[psets.col_label]=set;
-            row[psets.col_uri] = lilv_node_as_uri(preset);
-            row[psets.col_plug] = plug;
-            lilv_nodes_free(labels);
+// one plugin per line, see plugin_tsv()
+static int32_t print_plugins(Options& options) {
+    Catalog catalog;
+    catalog.jobs = options.jobs;
+    catalog.load(false);
+    PluginTable table;
+    for (std::vector<CatalogRecord>::iterator it = catalog.records.begin();
+                                    it != catalog.records.end(); ++it) {
+        table.append(*it);
+    }
+    std::vector<uint32_t> result;
+    find_plugins(table, options.filter, &result);
+    if (options.json) fputs("[", stdout);
+    for (std::vector<uint32_t>::iterator it = result.begin(); it != result.end(); ++it) {
+        size_t i = *it;
+        if (options.json) {
+            printf("%s\n {\"uri\": %s, \"name\": %s, \"class\": %s, \"author\": %s, "
+                   "\"audio_in\": %i, \"audio_out\": %i, \"midi_in\": %i, \"midi_out\": %i, "
+                   "\"control_in\": %i, \"control_out\": %i, \"cv_in\": %i, \"cv_out\": %i, "
+                   "\"latency\": %s, \"hard_rt\": %s, \"required\": %s}",
+                   it == result.begin() ? "" : ",",
+                   json_string(table.get(table.uri[i])).c_str(),
+                   json_string(table.get(table.name[i])).c_str(),
+                   json_string(table.get(table.cls[i])).c_str(),
+                   json_string(table.get(table.author[i])).c_str(),
+                   table.audio_in[i], table.audio_out[i], table.midi_in[i], table.midi_out[i],
+                   table.control_in[i], table.control_out[i], table.cv_in[i], table.cv_out[i],
+                   table.latency.test(i) ? "true" : "false",
+                   table.hard_rt.test(i) ? "true" : "false",
+                   json_string(table.get(table.required[i])).c_str());
         } else {
-            fprintf(stderr, _("Preset <%s> has no rdfs:label\n"),
-                    lilv_node_as_string(lilv_nodes_get(presets, i)));
+            fputs(plugin_tsv(table, i).c_str(), stdout);
+        }
+    }
+    if (options.json) fputs("\n]\n", stdout);
+    return 0;
+}
+
+// one preset per line: uri, label. The labels come from the catalog
+// cache, only a cache without them loads the whole world, once.
+static int32_t print_presets(Options& options) {
+    Catalog catalog;
+    catalog.jobs = options.jobs;
+    catalog.load(false);
+    bool known = false;
+    for (std::vector<CatalogRecord>::iterator it = catalog.records.begin();
+                                    !known && it != catalog.records.end(); ++it) {
+        known = it->uri == options.presets;
+    }
+    if (!known) {
+        fprintf(stderr, _("jalv.select: no plugin <%s>\n"), options.presets.c_str());
+        return 1;
+    }
+    catalog.index_presets();
+    const std::vector<PresetEntry>* presets = catalog.presets.find(options.presets);
+    if (options.json) fputs("[", stdout);
+    if (presets) {
+        for (std::vector<PresetEntry>::const_iterator it = presets->begin(); it != presets->end(); ++it) {
+            if (options.json) {
+                printf("%s\n {\"uri\": %s, \"label\": %s}", it == presets->begin() ? "" : ",",
+                       json_string(it->uri).c_str(), json_string(it->label).c_str());
+            } else {
+                printf("%s\t%s\n", it->uri.c_str(), tsv_field(it->label.c_str()).c_str());
+            }
+        }
+    }
+    if (options.json) fputs("\n]\n", stdout);
+    return 0;
+}
+
+// median and 99th percentile of the samples in milliseconds
+static void bench_report(const std::string& what, std::vector<double>& ms, size_t hits = 0) {
+    if (ms.empty()) return;
+    std::sort(ms.begin(), ms.end());
+    size_t n = ms.size();
+    double median = n % 2 ? ms[n / 2] : (ms[n / 2 - 1] + ms[n / 2]) / 2;
+    double p99 = ms[std::min(n - 1, (n * 99 + 99) / 100 - 1)];
+    printf("%-36s %8zu %12.3f %12.3f", what.c_str(), n, median, p99);
+    if (hits) printf(" %8zu", hits);
+    printf("\n");
+    ms.clear();
+}
+
+static double bench_ms(gint64 since) {
+    return (g_get_monotonic_time() - since) / 1000.0;
+}
+
+static void bench_table(Catalog& catalog, PluginTable* table) {
+    table->clear();
+    for (std::vector<CatalogRecord>::iterator it = catalog.records.begin();
+                                    it != catalog.records.end(); ++it) {
+        table->append(*it);
+    }
+}
+
+// the non-GTK work of the list with the functions it uses: the loading
+// thread, the search, the sort orders and the view of refill_list().
+// Use it with a corpus from bench/gen_corpus.sh.
+static int32_t run_bench(Options& options) {
+    std::vector<double> ms;
+    printf("%-36s %8s %12s %12s %8s\n", "", "samples", "median ms", "p99 ms", "rows");
+
+    for (int32_t r = 0; r < options.bench; r++) {
+        gint64 start = g_get_monotonic_time();
+        Catalog catalog;
+        catalog.jobs = options.jobs;
+        catalog.load(true);
+        catalog.index_presets();
+        catalog.index_classes();
+        PluginTable table;
+        bench_table(catalog, &table);
+        ms.push_back(bench_ms(start));
+    }
+    bench_report("catalog rescan, presets, classes", ms);
+
+    for (int32_t r = 0; r < options.bench; r++) {
+        gint64 start = g_get_monotonic_time();
+        Catalog catalog;
+        catalog.jobs = options.jobs;
+        catalog.load(false);
+        PluginTable table;
+        bench_table(catalog, &table);
+        ms.push_back(bench_ms(start));
+    }
+    bench_report("catalog from cache", ms);
+
+    Catalog catalog;
+    catalog.jobs = options.jobs;
+    catalog.load(false);
+    catalog.index_presets();
+    PluginTable table;
+    bench_table(catalog, &table);
+
+    static const char* queries[] = {
+        "a", "st", "tube", "stereo de", "reverb 12", "urn:jalv", "re:^Warm .* 1-", "xyzzy", NULL
+    };
+    std::vector<uint32_t> result;
+    for (const char** q = queries; *q; q++) {
+        for (int32_t r = 0; r < options.bench; r++) {
+            gint64 start = g_get_monotonic_time();
+            table.search.find(*q, &result);
+            ms.push_back(bench_ms(start));
+        }
+        bench_report(std::string("search \"") + *q + "\"", ms, result.size());
+    }
+    PortQuery ports;
+    std::string rest;
+    ports.parse("ain:2 aout:2+ midi:in", &rest);
+    Bitset port_bits;
+    for (int32_t r = 0; r < options.bench; r++) {
+        gint64 start = g_get_monotonic_time();
+        ports.apply(table, &port_bits);
+        ms.push_back(bench_ms(start));
+    }
+    bench_report("port query \"ain:2 aout:2+ midi:in\"", ms, port_bits.count());
+
+    // the permutations the sort orders are served from
+    static const char* order_names[] = { "name", "class", "author" };
+    std::vector<gint64> last_used(table.size(), 0);
+    std::vector<uint32_t> order;
+    for (int32_t o = SORT_NAME; o <= SORT_AUTHOR; o++) {
+        for (int32_t r = 0; r < options.bench; r++) {
+            gint64 start = g_get_monotonic_time();
+            sort_rows(table, last_used, SortOrder(o), &order);
+            ms.push_back(bench_ms(start));
         }
+        bench_report(std::string("sort by ") + order_names[o], ms, order.size());
+    }
+    sort_rows(table, last_used, SORT_NAME, &order);
+
+    // every 10th plugin a favorite, every 20th blacklisted, the rows
+    // in name order as refill_list() hands them to the store
+    Bitset fav_bits;
+    Bitset bl_bits;
+    fav_bits.resize(table.size());
+    bl_bits.resize(table.size());
+    for (size_t i = 0; i < table.size(); i++) {
+        fav_bits.set(i, i % 10 == 0);
+        bl_bits.set(i, i % 20 == 5);
     }
-    lilv_nodes_free(presets);
-    create_preset_menu(id, world);
+    std::vector<uint32_t> rows;
+    Bitset view;
+    for (int32_t r = 0; r < options.bench; r++) {
+        gint64 start = g_get_monotonic_time();
+        compose_view(table, fav_bits, bl_bits, true, false, NULL, NULL, NULL, &view);
+        view_rows(order, view, &rows);
+        ms.push_back(bench_ms(start));
+    }
+    bench_report("view favorites", ms, rows.size());
+    for (int32_t r = 0; r < options.bench; r++) {
+        gint64 start = g_get_monotonic_time();
+        compose_view(table, fav_bits, bl_bits, false, true, NULL, NULL, NULL, &view);
+        view_rows(order, view, &rows);
+        ms.push_back(bench_ms(start));
+    }
+    bench_report("view blacklist", ms, rows.size());
+    // favorites matching a search, the search itself is timed above
+    Bitset text_bits;
+    table.search.find("st", &result);
+    text_bits.assign(table.size(), result);
+    for (int32_t r = 0; r < options.bench; r++) {
+        gint64 start = g_get_monotonic_time();
+        compose_view(table, fav_bits, bl_bits, true, false, &text_bits, NULL, NULL, &view);
+        view_rows(order, view, &rows);
+        ms.push_back(bench_ms(start));
+    }
+    bench_report("view favorites + \"st\"", ms, rows.size());
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("plugins %zu, plugins with presets %zu, peak RSS %ld kB\n",
+           table.size(), catalog.presets.size(), usage.ru_maxrss);
+    return 0;
+}
+
+// the catalog comes from the same cache the window uses
+int32_t run_headless(Options& options) {
+    if (options.bench > 0) return run_bench(options);
+    if (!options.presets.empty()) return print_presets(options);
+    return print_plugins(options);
 }
 
 
 ///*** ----------- Class KeyGrabber functions ----------- ***///
 
-KeyGrabber::KeyGrabber()  {
-    start_keygrab_thread();
+bool KeyGrabber::grab_failed = false;
+
+KeyGrabber::KeyGrabber()
+    : dpy(NULL),
+    modifiers(0),
+    keycode(0),
+    runner(NULL) {
 }
 
 KeyGrabber::~KeyGrabber() {
-    stop_keygrab_thread();
+    io.disconnect();
+    if (!dpy) return;
+    ungrab_key();
+    XCloseDisplay(dpy);
 }
 
 KeyGrabber*  KeyGrabber::get_instance() {
@@ -240,125 +3228,179 @@ KeyGrabber*  KeyGrabber::get_instance() {
     return &instance;
 }
 
+// only installed around the grab, GDK keeps its own handler otherwise
 int32_t KeyGrabber::my_XErrorHandler(Display * d, XErrorEvent * e) {
-    static int32_t count = 0;
-    KeyGrabber *kg = KeyGrabber::get_instance();
-    if (!count) {
-        fprintf(stderr, _("X Error: try ControlMask | ShiftMask now \n"));
-        XUngrabKey(kg->dpy, kg->keycode, kg->modifiers, DefaultRootWindow(kg->dpy));
-        kg->modifiers = ControlMask | ShiftMask;
-        XGrabKey(kg->dpy, kg->keycode, kg->modifiers, DefaultRootWindow(kg->dpy),
+    grab_failed = true;
+    char buffer1[1024];
+    XGetErrorText(d, e->error_code, buffer1, 1024);
+    fprintf(stderr, _("X Error:  %s\n"), buffer1);
+    return 0;
+}
+
+// the key is grabbed with and without CapsLock and NumLock
+static const uint32_t lock_masks[] = { 0, LockMask, Mod2Mask, LockMask | Mod2Mask };
+
+bool KeyGrabber::grab_key(uint32_t mods) {
+    modifiers = mods;
+    grab_failed = false;
+    XErrorHandler old_handler = XSetErrorHandler(my_XErrorHandler);
+    for (size_t i = 0; i < sizeof(lock_masks) / sizeof(lock_masks[0]); i++) {
+        XGrabKey(dpy, keycode, modifiers | lock_masks[i], DefaultRootWindow(dpy),
           0, GrabModeAsync, GrabModeAsync);
-        count +=1;
-    } else {
-        char buffer1[1024];
-        XGetErrorText(d, e->error_code, buffer1, 1024);
-        fprintf(stderr, _("X Error:  %s\n Global HotKey disabled\n"), buffer1);
-        XUngrabKey(kg->dpy, kg->keycode, kg->modifiers, DefaultRootWindow(kg->dpy));
-        XFlush(kg->dpy);
-        XCloseDisplay(kg->dpy);
-        kg->stop_keygrab_thread();
     }
-    return 0;
+    XSync(dpy, False);
+    XSetErrorHandler(old_handler);
+    if (grab_failed) ungrab_key();
+    return !grab_failed;
 }
 
-void KeyGrabber::keygrab() {
-    dpy = XOpenDisplay(0);
-    XSetErrorHandler(my_XErrorHandler);
-    modifiers =  ShiftMask;
-    keycode = XKeysymToKeycode(dpy,XK_Escape);
-    XGrabKey(dpy, keycode, modifiers, DefaultRootWindow(dpy),
-      0, GrabModeAsync, GrabModeAsync);
-    XSync(dpy,true);
-    XSelectInput(dpy,DefaultRootWindow(dpy), KeyPressMask);
-    while(1) {
-        XNextEvent(dpy, &ev);
-        if (ev.type == KeyPress)
-            Glib::signal_idle().connect_once(
-              sigc::mem_fun(static_cast<LV2PluginList *>(runner), 
-              &LV2PluginList::systray_hide));
+void KeyGrabber::ungrab_key() {
+    XErrorHandler old_handler = XSetErrorHandler(my_XErrorHandler);
+    for (size_t i = 0; i < sizeof(lock_masks) / sizeof(lock_masks[0]); i++) {
+        XUngrabKey(dpy, keycode, modifiers | lock_masks[i], DefaultRootWindow(dpy));
     }
+    XSync(dpy, False);
+    XSetErrorHandler(old_handler);
 }
 
-void *KeyGrabber::run_keygrab_thread(void *p) {
-    KeyGrabber *kg = KeyGrabber::get_instance();
-    kg->keygrab();
-    return NULL;
+// accel is a GTK accelerator like "<Shift>Escape", the default
+// falls back to CTRL+SHIFT+ESCAPE when another client has it
+bool KeyGrabber::grab(const Glib::ustring& accel) {
+    guint keyval = 0;
+    GdkModifierType mods = GdkModifierType(0);
+    gtk_accelerator_parse(accel.empty() ? "<Shift>Escape" : accel.c_str(), &keyval, &mods);
+    if (!keyval) {
+        fprintf(stderr, _("jalv.select: unknown hotkey %s\n"), accel.c_str());
+        return false;
+    }
+    dpy = XOpenDisplay(0);
+    if (!dpy) return false;
+    // the core modifier bits are the same in GDK and X
+    uint32_t xmods = mods & (ShiftMask | ControlMask | Mod1Mask | Mod4Mask);
+    if (mods & GDK_SUPER_MASK) xmods |= Mod4Mask;
+    keycode = XKeysymToKeycode(dpy, keyval);
+    if (!keycode || (!grab_key(xmods) && (!accel.empty() || !grab_key(ControlMask | ShiftMask)))) {
+        fprintf(stderr, _(" Global HotKey disabled\n"));
+        XCloseDisplay(dpy);
+        dpy = NULL;
+        return false;
+    }
+    io = Glib::signal_io().connect(
+      sigc::mem_fun(*this, &KeyGrabber::on_x_event), ConnectionNumber(dpy), Glib::IO_IN);
+    return true;
 }
 
-void KeyGrabber::stop_keygrab_thread() {
-    pthread_cancel(m_pthr);
-    pthread_join(m_pthr, NULL);
+// Xlib may already hold events read along with a reply, so the
+// queue is drained, not only what the socket has
+bool KeyGrabber::on_x_event(Glib::IOCondition condition) {
+    while (XPending(dpy)) {
+        XEvent ev;
+        XNextEvent(dpy, &ev);
+        if (ev.type != KeyPress || (int32_t)ev.xkey.keycode != keycode) continue;
+        if ((ev.xkey.state & ~(LockMask | Mod2Mask)) != modifiers) continue;
+        on_hotkey(g_get_monotonic_time());
+    }
+    return true;
 }
 
-void KeyGrabber::start_keygrab_thread() {
-    pthread_attr_t      attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_JOINABLE );
-    pthread_setcancelstate (PTHREAD_CANCEL_ENABLE, NULL);
-    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
-    pthread_attr_setscope(&attr, PTHREAD_SCOPE_SYSTEM);
-    if (pthread_create(&m_pthr, &attr, run_keygrab_thread, NULL)) {
-        err = true;
+void KeyGrabber::on_hotkey(gint64 pressed) {
+    TraceSpan span("hotkey");
+    runner->hotkey_start = pressed;
+    runner->systray_hide();
+    if (!runner->get_visible()) {
+        runner->hotkey_start = 0;
+        log_timing("hotkey to hide", pressed);
     }
-    pthread_attr_destroy(&attr);
 }
 
 
 ///*** ----------- Class LV2PluginList functions ----------- ***///
 
-LV2PluginList::LV2PluginList() :
+LV2PluginList::LV2PluginList(Options& o) :
     la(getenv("LANG")),
+    sort_order(SORT_NAME),
     buttonQuit(_("_Quit"), true),
-    newList(_("_Refresh"), true),
     fav(_("_Fav."), true),
     bl(_("_BL."), true),
     lang(la.substr(0,2).c_str(), true),
+    newList(_("_Refresh"), true),
     textEntry(true),
     mainwin_x(-1),
     mainwin_y(-1),
     valid_plugs(0),
     invalid_plugs(0),
     tool_tip(" "),
+    filling_classes(false),
+    search_size(0),
+    new_world(false),
+    refreshing(false),
+    updating(false),
+    bundles_dirty(false),
+    load_pos(0),
+    load_count(0),
+    load_total(0),
+    load_done(false),
+    world_done(false),
+    load_updated(false),
+    list_done(false),
+    loading(false),
+    load_start(g_get_monotonic_time()),
     fav_changed(false),
     config_file(Glib::build_filename(Glib::get_user_config_dir(), "jalv.select.conf")),
     sys_config_file(Glib::build_filename("/etc/xdg/jalvselect", "jalv.select.conf")),
     bl_changed(false),
     backlist_file(Glib::build_filename(Glib::get_user_config_dir(), "jalv.select.back")),
     sys_backlist_file(Glib::build_filename("/etc/xdg/jalvselect", "jalv.select.back")),
-    new_world(false) {
+    recent_changed(false),
+    recent_file(Glib::build_filename(Glib::get_user_config_dir(), "jalv.select.recent")),
+    options(o),
+    hotkey_start(0) {
     set_title(_("LV2 plugs"));
     set_default_size(350,200);
+    interpreters.changed.connect(sigc::mem_fun(*this, &LV2PluginList::on_interpreters_changed));
     get_interpreter();
     fc = FiFoChannel::get_instance();
     fc->runner = this;
     kg = KeyGrabber::get_instance();
     kg->runner = this;
+    kg->grab(options.hotkey);
+    signal_map_event().connect(sigc::mem_fun(*this, &LV2PluginList::on_window_map));
 
-    listStore = Gtk::ListStore::create(pinfo);
-    treeView.set_model(listStore);
+    plugModel = PluginModel::create(table, fav_bits, bl_bits, last_used);
+    treeView.set_model(plugModel);
     treeView.append_column(_("Name"), pinfo.col_name);
-    treeView.append_column_editable(_("Favorite"), pinfo.col_fav);
-    treeView.append_column_editable(_("Blacklist"), pinfo.col_bl);
-    treeView.get_column(0)->set_min_width(400);
-    treeView.get_column(1)->set_max_width(75);
-    treeView.get_column(2)->set_max_width(60);
-  //  treeView.get_column(0)->set_sizing(Gtk::TREE_VIEW_COLUMN_FIXED);
-  //  treeView.get_column(1)->set_sizing(Gtk::TREE_VIEW_COLUMN_FIXED);
+    treeView.append_column(_("Favorite"), pinfo.col_fav);
+    treeView.append_column(_("Blacklist"), pinfo.col_bl);
+    // fixed height mode needs fixed columns, the name column takes the rest
+    treeView.get_column(0)->set_sizing(Gtk::TREE_VIEW_COLUMN_FIXED);
+    treeView.get_column(0)->set_fixed_width(400);
+    treeView.get_column(0)->set_expand(true);
+    treeView.get_column(1)->set_sizing(Gtk::TREE_VIEW_COLUMN_FIXED);
+    treeView.get_column(1)->set_fixed_width(75);
     treeView.get_column(2)->set_sizing(Gtk::TREE_VIEW_COLUMN_FIXED);
+    treeView.get_column(2)->set_fixed_width(60);
+    // the model is read only, the toggle handlers flip the bits
     Gtk::CellRendererToggle *cell = dynamic_cast<Gtk::CellRendererToggle*>(
       treeView.get_column(1)->get_first_cell());
     Gtk::CellRendererToggle *cellb = dynamic_cast<Gtk::CellRendererToggle*>(
       treeView.get_column(2)->get_first_cell());
-    treeView.set_tooltip_column(2);
+    cell->set_activatable(true);
+    cellb->set_activatable(true);
+    treeView.set_has_tooltip(true);
     treeView.set_rules_hint(true);
-  //  treeView.set_fixed_height_mode(true);
+    treeView.set_fixed_height_mode(true);
     treeView.set_name("lv2_treeview" );
-    listStore->set_sort_column(pinfo.col_name, Gtk::SORT_ASCENDING );
     read_fav_list();
     read_bl_list();
-    fill_list();
-    fill_class_list();
+    read_recent_list();
+    pstore.launcher.on_launch = sigc::mem_fun(*this, &LV2PluginList::on_plugin_launched);
+    catalog = std::make_shared<Catalog>();
+    load_dispatcher.connect(sigc::mem_fun(*this, &LV2PluginList::on_load_notify));
+    fill_list(false);
+    watcher.on_changed = sigc::mem_fun(*this, &LV2PluginList::on_bundles_changed);
+    watcher.watch();
+    control.on_request = sigc::mem_fun(*this, &LV2PluginList::on_control_request);
+    control.open();
 
 
     Glib::ustring data = "treeview { border-bottom-color: rgba(125,125,125,0.5); border-bottom-style: solid; border-bottom-width: 1px;}";
@@ -385,6 +3427,13 @@ LV2PluginList::LV2PluginList() :
     topBox.pack_end(buttonBox,Gtk::PACK_SHRINK);
     buttonBox.pack_start(comboBox,Gtk::PACK_SHRINK);
     buttonBox.pack_start(textEntry,Gtk::PACK_EXPAND_WIDGET);
+    sortBox.append(_("Name"));
+    sortBox.append(_("Class"));
+    sortBox.append(_("Author"));
+    sortBox.append(_("Recent"));
+    sortBox.set_active(SORT_NAME);
+    sortBox.set_tooltip_text(_("Sort order"));
+    buttonBox.pack_start(sortBox,Gtk::PACK_SHRINK);
 
     Glib::ustring::size_type found = la.find("en");
     if (found == Glib::ustring::npos) {
@@ -414,6 +3463,8 @@ LV2PluginList::LV2PluginList() :
       sigc::mem_fun(*this, &LV2PluginList::on_fav_toggle));
     cellb->signal_toggled().connect(
       sigc::mem_fun(*this, &LV2PluginList::on_bl_toggle));
+    treeView.signal_query_tooltip().connect(
+      sigc::mem_fun(*this, &LV2PluginList::on_query_tooltip));
     treeView.signal_button_release_event().connect_notify(
       sigc::mem_fun(*this, &LV2PluginList::button_release_event));
     treeView.signal_key_release_event().connect(
@@ -430,6 +3481,8 @@ LV2PluginList::LV2PluginList() :
       sigc::mem_fun(*this, &LV2PluginList::on_combo_changed));
     textEntry.signal_changed().connect(
       sigc::mem_fun(*this, &LV2PluginList::on_entry_changed));
+    sortBox.signal_changed().connect(
+      sigc::mem_fun(*this, &LV2PluginList::on_sort_changed));
     status_icon->signal_activate().connect(
       sigc::mem_fun(*this, &LV2PluginList::systray_hide));
     status_icon->signal_popup_menu().connect(
@@ -444,31 +3497,37 @@ LV2PluginList::LV2PluginList() :
 }
 
 LV2PluginList::~LV2PluginList() {
-    lilv_world_free(world);
+    stop_loading();
 }
 
 void LV2PluginList::get_interpreter() {
-    if (system(NULL) )
-      system("echo $PATH | tr ':' '\n' | xargs ls  | grep jalv | gawk '{if ($0 == \"jalv\") {print \"jalv -s\"} else {print $0}}' | sort -u >/tmp/jalv.interpreter" );
-    std::ifstream input( "/tmp/jalv.interpreter" );
-    int32_t s = 0;
-    for( std::string line; getline( input, line ); ) {
-        if ((line.compare("jalv.select") !=0)){
-            comboBox.append(line);
-            if ((line.compare("jalv.gtk") ==0))
-                comboBox.set_active(s);
-                s++;
-        }
-    }
+    TraceSpan span("get_interpreter");
+    interpreters.load();
+    fill_interpreter_list();
+    interpreters.rescan();
+}
 
-    if (!system("which carla-single > /dev/null 2>&1")) {
-        comboBox.append("carla-single");
-    }
-    
-    if (!system("which lv2lint > /dev/null 2>&1")) {
-        comboBox.append("lv2lint");
+void LV2PluginList::on_interpreters_changed() {
+    if (interpreters.update()) fill_interpreter_list();
+}
+
+// keeps the selected interpreter when it's still there
+void LV2PluginList::fill_interpreter_list() {
+    Glib::ustring active = comboBox.get_active_text();
+    int32_t active_row = -1;
+    int32_t default_row = -1;
+    int32_t s = 0;
+    comboBox.remove_all();
+    for (std::vector<std::string>::iterator it = interpreters.names.begin();
+                                   it != interpreters.names.end(); ++it, ++s) {
+        comboBox.append(*it);
+        if (it->compare("jalv.gtk") == 0) default_row = s;
+        if (active.compare(*it) == 0) active_row = s;
     }
     comboBox.append("jalv.gtk -d");
+    if (active.compare("jalv.gtk -d") == 0) active_row = s;
+    if (active_row >= 0) comboBox.set_active(active_row);
+    else if (default_row >= 0) comboBox.set_active(default_row);
     pstore.interpret = comboBox.get_active_text(); 
 }
 
@@ -482,7 +3541,7 @@ void LV2PluginList::read_fav_list() {
     Glib::RefPtr<Gio::DataInputStream> in = Gio::DataInputStream::create(file->read());    
     std::string line;
     while (in->read_line(line)) {
-        favs.push_back(line);
+        favs.insert(line);
     }
     in->close();
 }
@@ -491,45 +3550,28 @@ void LV2PluginList::save_fav_list() {
     Glib::RefPtr<Gio::File> file = Gio::File::create_for_path(config_file);
     if (!file) return;
     Glib::RefPtr<Gio::DataOutputStream> out = Gio::DataOutputStream::create(file->replace());
-    typedef Gtk::TreeModel::Children type_children;
-    type_children children = listStore->children();
+    std::vector<std::string> ids(favs.begin(), favs.end());
+    sort(ids.begin(), ids.end());
     Glib::ustring id;
-    for (std::vector<Glib::ustring>::iterator it = favs.begin() ; it != favs.end(); ++it) {
+    for (std::vector<std::string>::iterator it = ids.begin() ; it != ids.end(); ++it) {
         id += (*it);
         id += "\n";
     }
     out->put_string(id);
-    out->flush ();
-    out->close ();
-}
-
-bool LV2PluginList::is_fav(Glib::ustring id) {
-    for (std::vector<Glib::ustring>::iterator it = favs.begin() ; it != favs.end(); ++it) {
-        if (id.compare(*it)==0) return true;
-    }
-    return false;
+    out->flush ();
+    out->close ();
 }
 
 void LV2PluginList::on_fav_toggle(Glib::ustring path) {
     if(path.empty()) return;
-    auto row = *listStore->get_iter(Gtk::TreeModel::Path(path));
-    if(row[pinfo.col_fav] == true) {
-        Glib::ustring id = row[pinfo.col_id];
-        if (id.empty()) return;
-        for (std::vector<Glib::ustring>::iterator it = favs.begin() ; it != favs.end(); ++it) {
-            if (id.compare(*it)==0) return;
-        }
-        favs.push_back(id);
-    } else {
-        Glib::ustring id = row[pinfo.col_id];
-        if (id.empty()) return;
-        for (std::vector<Glib::ustring>::iterator it = favs.begin() ; it != favs.end(); ++it) {
-            if (id.compare(*it)==0) {
-                favs.erase(it);
-                break;
-            }
-        }
-    }
+    Gtk::TreeModel::Path p(path);
+    int i = plugModel->get_index(plugModel->get_iter(p));
+    if (i < 0 || (size_t)i >= table.size()) return;
+    bool value = !is_fav(i);
+    fav_bits.set(i, value);
+    plugModel->update_row(p);
+    if (value) favs.insert(table.get(table.uri[i]));
+    else favs.erase(table.get(table.uri[i]));
     fav_changed = true;
     if (fav.get_active()) on_fav_button();
 }
@@ -545,7 +3587,7 @@ void LV2PluginList::read_bl_list() {
     Glib::RefPtr<Gio::DataInputStream> in = Gio::DataInputStream::create(file->read());    
     std::string line;
     while (in->read_line(line)) {
-        bls.push_back(line);
+        bls.insert(line);
     }
     in->close();
 }
@@ -554,10 +3596,10 @@ void LV2PluginList::save_bl_list() {
     Glib::RefPtr<Gio::File> file = Gio::File::create_for_path(backlist_file);
     if (!file) return;
     Glib::RefPtr<Gio::DataOutputStream> out = Gio::DataOutputStream::create(file->replace());
-    typedef Gtk::TreeModel::Children type_children;
-    type_children children = listStore->children();
+    std::vector<std::string> ids(bls.begin(), bls.end());
+    sort(ids.begin(), ids.end());
     Glib::ustring id;
-    for (std::vector<Glib::ustring>::iterator it = bls.begin() ; it != bls.end(); ++it) {
+    for (std::vector<std::string>::iterator it = ids.begin() ; it != ids.end(); ++it) {
         id += (*it);
         id += "\n";
     }
@@ -566,44 +3608,57 @@ void LV2PluginList::save_bl_list() {
     out->close ();
 }
 
-bool LV2PluginList::is_bl(Glib::ustring id) {
-    for (std::vector<Glib::ustring>::iterator it = bls.begin() ; it != bls.end(); ++it) {
-        if (id.compare(*it)==0) return true;
-    }
-    return false;
-}
-
 void LV2PluginList::on_bl_toggle(Glib::ustring path) {
     if(path.empty()) return;
-    auto row = *listStore->get_iter(Gtk::TreeModel::Path(path));
-    if(row[pinfo.col_bl] == true) {
-        Glib::ustring id = row[pinfo.col_id];
-        if (id.empty()) return;
-        for (std::vector<Glib::ustring>::iterator it = bls.begin() ; it != bls.end(); ++it) {
-            if (id.compare(*it)==0) return;
-        }
-        bls.push_back(id);
-    } else {
-        Glib::ustring id = row[pinfo.col_id];
-        if (id.empty()) return;
-        for (std::vector<Glib::ustring>::iterator it = bls.begin() ; it != bls.end(); ++it) {
-            if (id.compare(*it)==0) {
-                bls.erase(it);
-                break;
-            }
-        }
-    }
+    Gtk::TreeModel::Path p(path);
+    int i = plugModel->get_index(plugModel->get_iter(p));
+    if (i < 0 || (size_t)i >= table.size()) return;
+    bool value = !is_bl(i);
+    bl_bits.set(i, value);
+    plugModel->update_row(p);
+    if (value) bls.insert(table.get(table.uri[i]));
+    else bls.erase(table.get(table.uri[i]));
     bl_changed = true;
     if (bl.get_active()) on_bl_button();
 }
 
-void LV2PluginList::truncate_name(Glib::ustring *name) {
-    if (name->size() > 25) {
-        size_t rem = name->find(" - ");
-        if(rem != Glib::ustring::npos) {
-            name->erase(rem);
-        }
-    }    
+// one line per plugin: seconds since the epoch of the last launch, uri
+void LV2PluginList::read_recent_list() {
+    Glib::RefPtr<Gio::File> file = Gio::File::create_for_path(recent_file);
+    if (!file->query_exists()) return;
+    Glib::RefPtr<Gio::DataInputStream> in = Gio::DataInputStream::create(file->read());
+    std::string line;
+    while (in->read_line(line)) {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos) continue;
+        recent[line.substr(tab + 1)] = g_ascii_strtoll(line.c_str(), NULL, 10);
+    }
+    in->close();
+}
+
+void LV2PluginList::save_recent_list() {
+    Glib::RefPtr<Gio::File> file = Gio::File::create_for_path(recent_file);
+    if (!file) return;
+    Glib::RefPtr<Gio::DataOutputStream> out = Gio::DataOutputStream::create(file->replace());
+    Glib::ustring id;
+    for (std::unordered_map<std::string, gint64>::iterator it = recent.begin();
+                                                  it != recent.end(); ++it) {
+        id += to_string(it->second) + "\t" + it->first + "\n";
+    }
+    out->put_string(id);
+    out->flush ();
+    out->close ();
+}
+
+// only the recent order depends on the launches
+void LV2PluginList::on_plugin_launched(const std::string& uri) {
+    gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+    recent[uri] = now;
+    recent_changed = true;
+    int32_t i = table.find(uri);
+    if (i >= 0) last_used[i] = now;
+    orders[SORT_RECENT].clear();
+    if (sort_order == SORT_RECENT) refill_list();
 }
 
 void LV2PluginList::on_lang_button() {
@@ -620,347 +3675,648 @@ void LV2PluginList::on_lang_button() {
     }
 }
 
-void LV2PluginList::fill_tooltip(Glib::ustring *tip, const LilvPlugin* plug) {
+// the favorites and the blacklist combine with each other, the class
+// and the search, both together show the blacklisted favorites
+void LV2PluginList::on_fav_button() {
+    refill_list();
+    if (fav.get_active()) {
+        fav.set_label(_(" _All "));
+    } else {
+        fav.set_label(_("_Fav."));
+    }
+}
 
-    LilvNode* lv2_AudioPort = (lilv_new_uri(world, LV2_CORE__AudioPort));
-    LilvNode* lv2_InputPort = (lilv_new_uri(world, LV2_CORE__InputPort));
-    LilvNode* lv2_OutputPort = (lilv_new_uri(world, LV2_CORE__OutputPort));
-    LilvNode* lv2_EventPort = (lilv_new_uri(world, LILV_URI_EVENT_PORT));
-    LilvNode* lv2_MidiPort = (lilv_new_uri(world, LILV_URI_MIDI_EVENT));
-    LilvNode* lv2_AtomPort = lilv_new_uri(world, LV2_ATOM__AtomPort);
-    LilvNode* lv2_atom_supports = lilv_new_uri(world, LV2_ATOM__supports);
-    
-    unsigned int num_ports = lilv_plugin_get_num_ports(plug);
-    unsigned int n_in = 0;
-    unsigned int n_out = 0;
-    unsigned int n_midi_in = 0;
-    unsigned int n_midi_out = 0;
-    for (unsigned int n = 0; n < num_ports; n++) {
-        const LilvPort* port = lilv_plugin_get_port_by_index(plug, n);
-        if (lilv_port_is_a(plug, port, lv2_AudioPort)) {
-            if (lilv_port_is_a(plug, port, lv2_InputPort)) {
-                n_in += 1;
-            } else {
-                n_out += 1;
-            }
-        } else if (lilv_port_is_a(plug, port, lv2_AtomPort)) {
-            LilvNodes* atom_supports = lilv_port_get_value(
-              plug, port, lv2_atom_supports);
-            if (lilv_nodes_contains(atom_supports, lv2_MidiPort)) {
-                if (lilv_port_is_a(plug, port, lv2_InputPort)) {
-                    n_midi_in += 1;
-                }
-                if (lilv_port_is_a(plug, port, lv2_OutputPort)) {
-                    n_midi_out += 1;
-                }
-            }
-            lilv_nodes_free(atom_supports);
+void LV2PluginList::on_bl_button() {
+    refill_list();
+    if (bl.get_active()) {
+        bl.set_label(_(" _All "));
+    } else {
+        bl.set_label(_("_BL."));
+    }
+}
+
+///*** ----------- background loading of the catalog ----------- ***///
+
+// the catalog is loaded in a worker thread, new records are queued and
+// the GUI thread streams them into the list from an idle handler.
+// A refresh of a complete list instead builds a whole new generation,
+// table included, in the worker and swaps it in at once.
+// Changed bundles are reloaded in the worker as well, into a generation
+// which starts as a copy of the one in use.
+
+void LV2PluginList::fill_list(bool rescan) {
+    stop_loading();
+    loader = std::make_shared<Catalog>();
+    loader->jobs = options.jobs;
+    loader->on_records = sigc::mem_fun(*this, &LV2PluginList::on_catalog_records);
+    loader->on_progress = sigc::mem_fun(*this, &LV2PluginList::on_catalog_progress);
+    load_count = 0;
+    load_total = 0;
+    load_done = false;
+    world_done = false;
+    loading = true;
+    load_start = g_get_monotonic_time();
+    refreshing = rescan && list_done;
+    if (refreshing) {
+        tool_tip = _("Refreshing LV2 plugins");
+        if (status_icon) status_icon->set_tooltip_text(tool_tip);
+        load_thread = std::thread(&LV2PluginList::load_catalog, this, rescan);
+        return;
+    }
+    valid_plugs = 0;
+    invalid_plugs = 0;
+    load_pending.clear();
+    load_pos = 0;
+    load_seen.clear();
+    search_idle.disconnect();
+    plugModel->clear();
+    table.clear();
+    fav_bits.clear();
+    bl_bits.clear();
+    last_used.clear();
+    clear_orders();
+    search_size = 0;
+    list_done = false;
+    load_thread = std::thread(&LV2PluginList::load_catalog, this, rescan);
+}
+
+void LV2PluginList::stop_loading() {
+    if (!load_thread.joinable()) return;
+    loader->cancelled = true;
+    load_thread.join();
+    load_idle.disconnect();
+    loader.reset();
+    next_table.clear();
+    std::lock_guard<std::mutex> lock(load_mutex);
+    load_queue.clear();
+    loading = false;
+    updating = false;
+}
+
+// runs in the loading thread
+void LV2PluginList::load_catalog(bool rescan) {
+    loader->load(rescan);
+    if (refreshing) {
+        for (std::vector<CatalogRecord>::iterator it = loader->records.begin();
+                         !loader->cancelled && it != loader->records.end(); ++it) {
+            next_table.append(*it);
         }
     }
-    if(n_in !=0) {
-        (*tip) += _("\nAudio Inputs: ") ;
-        (*tip) += to_string(n_in);
+    {
+        std::lock_guard<std::mutex> lock(load_mutex);
+        load_done = true;
     }
-    if(n_out !=0) {
-        (*tip) += _("\nAudio Outputs: ") ;
-        (*tip) += to_string(n_out);
+    load_dispatcher.emit();
+    // the catalog may come from the cache, the presets need the full world
+    if (!loader->cancelled) {
+        loader->index_presets();
+        loader->index_classes();
     }
-    if(n_midi_in !=0) {
-        (*tip) += _("\nMidi Inputs: ") ;
-        (*tip) += to_string(n_midi_in);
+    {
+        std::lock_guard<std::mutex> lock(load_mutex);
+        world_done = true;
     }
-    if(n_midi_out !=0) {
-        (*tip) += _("\nMidi Outputs: ") ;
-        (*tip) += to_string(n_midi_out);
+    load_dispatcher.emit();
+}
+
+// runs in the loading thread
+void LV2PluginList::on_catalog_records(const CatalogRecord* recs, size_t n) {
+    if (refreshing) return;
+    {
+        std::lock_guard<std::mutex> lock(load_mutex);
+        load_queue.insert(load_queue.end(), recs, recs + n);
     }
-    lilv_node_free(lv2_AudioPort);
-    lilv_node_free(lv2_InputPort);
-    lilv_node_free(lv2_OutputPort);
-    lilv_node_free(lv2_EventPort);
-    lilv_node_free(lv2_MidiPort);
-    lilv_node_free(lv2_AtomPort);
-    lilv_node_free(lv2_atom_supports);
+    load_dispatcher.emit();
 }
 
-void LV2PluginList::on_fav_button() {
-    Glib::ustring name;
-    Glib::ustring tip;
-    Glib::ustring id;
-    bool found = false;
-    Glib::ustring tipby = _(" \nby ");
-    LilvNode* nd;
-    listStore->clear();
-    for (LilvIter* it = lilv_plugins_begin(lv2_plugins);
-      !lilv_plugins_is_end(lv2_plugins, it);
-      it = lilv_plugins_next(lv2_plugins, it)) {
-        found = false;
-        const LilvPlugin* plug = lilv_plugins_get(lv2_plugins, it);
-        if (plug) {
-            nd = lilv_plugin_get_name(plug);
-        }
-        if (nd) {
-            name = lilv_node_as_string(nd);
-            const LilvPluginClass* cls = lilv_plugin_get_class(plug);
-            tip = lilv_node_as_string(lilv_plugin_class_get_label(cls));
-            id = lilv_node_as_string(lilv_plugin_get_uri(plug));
-            truncate_name(&name);
-        } else {
-           continue;
-        }
-        lilv_node_free(nd);
-        if (fav.get_active()) {
-            for (std::vector<Glib::ustring>::iterator it = favs.begin() ; it != favs.end(); ++it) {
-                if (id.compare(*it)==0) found = true;
-            }
-        } else {
-            found = true;
-        }
-        if (found && !is_bl(lilv_node_as_string(lilv_plugin_get_uri(plug)))){
-            row = *(listStore->append());
-            row[pinfo.col_plug] = plug;
-            row[pinfo.col_id] = lilv_node_as_string(lilv_plugin_get_uri(plug));
-            row[pinfo.col_name] = name;
-            row[pinfo.col_fav] = is_fav(lilv_node_as_string(lilv_plugin_get_uri(plug)));
-            row[pinfo.col_bl] = is_bl(lilv_node_as_string(lilv_plugin_get_uri(plug)));
-            nd = lilv_plugin_get_author_name(plug);
-            if (!nd) {
-                nd = lilv_plugin_get_project(plug);
-            }
-            if (nd) {
-                tip += tipby + lilv_node_as_string(nd);
-            }
-            lilv_node_free(nd);
-            fill_tooltip(&tip, plug);
-            row[pinfo.col_tip] = tip;
-        } 
+// runs in the loading thread
+void LV2PluginList::on_catalog_progress(uint32_t count, uint32_t total) {
+    std::lock_guard<std::mutex> lock(load_mutex);
+    load_count = count;
+    load_total = total;
+}
+
+void LV2PluginList::on_load_notify() {
+    if (!loading) return;
+    if (updating) {
+        finish_update();
+    } else if (refreshing) {
+        swap_generation();
+    } else if (list_done) {
+        take_world();
+    } else if (!load_idle.connected()) {
+        load_idle = Glib::signal_idle().connect(
+          sigc::mem_fun(*this, &LV2PluginList::on_load_idle));
     }
-    if (fav.get_active()) {
-        fav.set_label(_(" _All "));
-        if (bl.get_active()) {
-            bl_c.block(true);
-            bl.set_active(false);
-            bl.set_label(_("_BL."));
-            bl_c.unblock();
-        }
-    } else {
-        fav.set_label(_("_Fav."));
+}
+
+bool LV2PluginList::on_load_idle() {
+    TraceSpan span("list fill batch");
+    bool done = false;
+    uint32_t count = 0;
+    uint32_t total = 0;
+    if (load_pos >= load_pending.size()) {
+        load_pending.clear();
+        load_pos = 0;
+        std::lock_guard<std::mutex> lock(load_mutex);
+        load_pending.swap(load_queue);
+    }
+    {
+        std::lock_guard<std::mutex> lock(load_mutex);
+        done = load_done && load_queue.empty();
+        count = load_count;
+        total = load_total;
     }
+    bool is_filtered = filtered();
+    for (size_t end = std::min(load_pos + 200, load_pending.size()); load_pos < end; load_pos++) {
+        const CatalogRecord& rec = load_pending[load_pos];
+        if (!load_seen.insert(std::make_pair(rec.uri, rec.bundle)).second) continue;
+        if (!table.append(rec)) continue;
+        mark_plugin(table.size() - 1);
+        if (is_filtered || is_bl(table.size() - 1)) continue;
+        if (!valid_plugs) log_timing("first row", load_start);
+        valid_plugs++;
+        plugModel->insert_row(table.size() - 1);
+    }
+    if (load_pos < load_pending.size()) {
+        done = false;
+    }
+    if (done) {
+        finish_loading();
+        take_world();
+        return false;
+    }
+    tool_tip = _("Loading LV2 plugins: ") + to_string(count);
+    if (total) tool_tip += " / " + to_string(total);
+    if (status_icon) status_icon->set_tooltip_text(tool_tip);
+    return load_pos < load_pending.size();
 }
 
-void LV2PluginList::on_bl_button() {
-    Glib::ustring name;
-    Glib::ustring tip;
-    Glib::ustring id;
-    bool found = false;
-    bool view_backlist = false;
-    Glib::ustring tipby = _(" \nby ");
-    LilvNode* nd;
-    listStore->clear();
-    for (LilvIter* it = lilv_plugins_begin(lv2_plugins);
-      !lilv_plugins_is_end(lv2_plugins, it);
-      it = lilv_plugins_next(lv2_plugins, it)) {
-        found = false;
-        const LilvPlugin* plug = lilv_plugins_get(lv2_plugins, it);
-        if (plug) {
-            nd = lilv_plugin_get_name(plug);
-        }
-        if (nd) {
-            name = lilv_node_as_string(nd);
-            const LilvPluginClass* cls = lilv_plugin_get_class(plug);
-            tip = lilv_node_as_string(lilv_plugin_class_get_label(cls));
-            id = lilv_node_as_string(lilv_plugin_get_uri(plug));
-            truncate_name(&name);
+void LV2PluginList::finish_loading() {
+    // the final catalog is sorted and keeps the record of the bundle which
+    // comes first in LV2_PATH, a row streamed from another bundle, which
+    // depends on the order the helpers finish in, is replaced
+    std::set<int> gone;
+    std::vector<uint32_t> added;
+    for (std::vector<CatalogRecord>::iterator it = loader->records.begin();
+                                    it != loader->records.end(); ++it) {
+        std::unordered_map<std::string, uint32_t>::iterator seen = load_seen.find(it->uri);
+        if (seen == load_seen.end()) {
+            load_seen[it->uri] = it->bundle;
+        } else if (seen->second == it->bundle) {
+            continue;
         } else {
-           continue;
+            seen->second = it->bundle;
+            int32_t i = table.find(it->uri);
+            if (i >= 0) gone.insert(i);
+            table.remove(it->uri);
+            table.invalid.erase(std::remove(table.invalid.begin(), table.invalid.end(), it->uri),
+                                table.invalid.end());
         }
-        lilv_node_free(nd);
-        if (bl.get_active()) {
-            view_backlist = true;
-            for (std::vector<Glib::ustring>::iterator it = bls.begin() ; it != bls.end(); ++it) {
-                if (id.compare(*it)==0) found = true;
-            }
-        } else {
-            found = true;
-        }
-        if (found && (view_backlist || !is_bl(lilv_node_as_string(lilv_plugin_get_uri(plug))))){
-            row = *(listStore->append());
-            row[pinfo.col_plug] = plug;
-            row[pinfo.col_id] = lilv_node_as_string(lilv_plugin_get_uri(plug));
-            row[pinfo.col_name] = name;
-            row[pinfo.col_fav] = is_fav(lilv_node_as_string(lilv_plugin_get_uri(plug)));
-            row[pinfo.col_bl] = is_bl(lilv_node_as_string(lilv_plugin_get_uri(plug)));
-            nd = lilv_plugin_get_author_name(plug);
-            if (!nd) {
-                nd = lilv_plugin_get_project(plug);
-            }
-            if (nd) {
-                tip += tipby + lilv_node_as_string(nd);
-            }
-            lilv_node_free(nd);
-            fill_tooltip(&tip, plug);
-            row[pinfo.col_tip] = tip;
-        } 
+        if (!table.append(*it)) continue;
+        mark_plugin(table.size() - 1);
+        added.push_back(table.size() - 1);
     }
-    if (bl.get_active()) {
-        bl.set_label(_(" _All "));
-        if (fav.get_active()) {
-            fav_c.block(true);
-            fav.set_active(false);
-            fav.set_label(_("_Fav."));
-            fav_c.unblock();
+    if (!gone.empty()) plugModel->remove_rows(gone);
+    if (!filtered()) {
+        for (std::vector<uint32_t>::iterator it = added.begin(); it != added.end(); ++it) {
+            if (!is_bl(*it)) plugModel->insert_row(*it);
         }
-    } else {
-        bl.set_label(_("_BL."));
     }
+    list_done = true;
+    update_status();
+    fill_class_list();
+    if (filtered()) refill_list();
+    log_timing("list complete", load_start);
+    if (Trace::is_enabled()) Trace::complete("list fill", load_start);
 }
 
-void LV2PluginList::fill_list() {
-    valid_plugs = 0;
-    invalid_plugs = 0;
-    Glib::ustring invalid = "";
-    Glib::ustring tip;
-    Glib::ustring tipby = _(" \nby ");
-    Glib::ustring name;
-    world = lilv_world_new();
-    lilv_world_load_all(world);
-    lv2_plugins = lilv_world_get_all_plugins(world);        
-    LilvNode* nd = NULL;
+// the world and its preset index are the last things the loading thread delivers
+void LV2PluginList::take_world() {
+    {
+        std::lock_guard<std::mutex> lock(load_mutex);
+        if (!world_done) return;
+    }
+    load_thread.join();
+    catalog = loader;
+    loader.reset();
+    loading = false;
+    log_timing("presets indexed", load_start);
+    // the class tree comes with the world
+    fill_class_list();
+    if (!class_filter.empty()) refill_list();
+    if (bundles_dirty) on_bundles_changed();
+}
 
-    for (LilvIter* it = lilv_plugins_begin(lv2_plugins);
-      !lilv_plugins_is_end(lv2_plugins, it);
-      it = lilv_plugins_next(lv2_plugins, it)) {
-        const LilvPlugin* plug = lilv_plugins_get(lv2_plugins, it);
-        if (plug) {
-            nd = lilv_plugin_get_name(plug);
-            if (nd) {
-                name = lilv_node_as_string(nd);
-                truncate_name(&name);
-            }
+// the old generation stays in use until the new one is complete,
+// rows only carry table indices, so the views are rebuilt on the new table
+void LV2PluginList::swap_generation() {
+    {
+        std::lock_guard<std::mutex> lock(load_mutex);
+        if (!world_done) return;
+    }
+    load_thread.join();
+    table.swap(next_table);
+    next_table.clear();
+    catalog = loader;
+    loader.reset();
+    loading = false;
+    fav_bits.clear();
+    bl_bits.clear();
+    last_used.clear();
+    clear_orders();
+    for (size_t i = 0; i < table.size(); i++) mark_plugin(i);
+    search_size = 0;
+    update_status();
+    fill_class_list();
+    refill_list();
+    log_timing("refresh complete", load_start);
+    if (Trace::is_enabled()) Trace::complete("list fill", load_start, "refresh");
+    if (bundles_dirty) on_bundles_changed();
+}
+
+// bundles were added, removed or changed on disk, the loading thread
+// reloads only those into a new generation
+void LV2PluginList::on_bundles_changed() {
+    // a generation which is still loading may have missed the change
+    if (loading || !catalog->presets_complete) {
+        bundles_dirty = true;
+        return;
+    }
+    bundles_dirty = false;
+    loader = std::make_shared<Catalog>();
+    loader->jobs = options.jobs;
+    load_done = false;
+    world_done = false;
+    load_updated = false;
+    load_changed.clear();
+    loading = true;
+    updating = true;
+    load_start = g_get_monotonic_time();
+    load_thread = std::thread(&LV2PluginList::update_catalog, this, catalog);
+}
+
+// runs in the loading thread, the generation in use is only read here
+// except for its world, which the GUI thread never touches
+void LV2PluginList::update_catalog(std::shared_ptr<Catalog> base) {
+    loader->copy_from(*base);
+    std::set<std::string> changed;
+    bool updated = loader->update(&changed);
+    {
+        std::lock_guard<std::mutex> lock(load_mutex);
+        load_changed.swap(changed);
+        load_updated = updated;
+        world_done = true;
+    }
+    load_dispatcher.emit();
+}
+
+// only the rows of the changed plugins are replaced
+void LV2PluginList::finish_update() {
+    std::set<std::string> changed;
+    bool updated = false;
+    {
+        std::lock_guard<std::mutex> lock(load_mutex);
+        if (!world_done) return;
+        changed.swap(load_changed);
+        updated = load_updated;
+    }
+    load_thread.join();
+    loading = false;
+    updating = false;
+    // the new generation holds the world now, even when nothing changed
+    catalog = loader;
+    loader.reset();
+    watcher.watch();
+    if (updated) {
+        std::set<int> gone;
+        for (std::set<std::string>::iterator it = changed.begin(); it != changed.end(); ++it) {
+            int32_t i = table.find(*it);
+            if (i < 0) continue;
+            gone.insert(i);
+            table.remove(*it);
         }
-        if (nd && !is_bl(lilv_node_as_string(lilv_plugin_get_uri(plug)))) {
-            row = *(listStore->append());
-            if (!name.empty()) row[pinfo.col_name] = name;
-            else row[pinfo.col_name] = lilv_node_as_string(nd);
-            row[pinfo.col_plug] = plug;
-            row[pinfo.col_id] = lilv_node_as_string(lilv_plugin_get_uri(plug));
-            row[pinfo.col_fav] = is_fav(lilv_node_as_string(lilv_plugin_get_uri(plug)));
-            row[pinfo.col_bl] = is_bl(lilv_node_as_string(lilv_plugin_get_uri(plug)));
-            valid_plugs++;
-        } else if (!is_bl(lilv_node_as_string(lilv_plugin_get_uri(plug)))) {
-            invalid += "\n";
-            invalid += lilv_node_as_string(lilv_plugin_get_uri(plug));
-            invalid_plugs++;
-            continue;
+        std::vector<uint32_t> added;
+        for (std::vector<CatalogRecord>::iterator it = catalog->records.begin();
+                                        it != catalog->records.end(); ++it) {
+            if (!changed.count(it->uri) || !table.append(*it)) continue;
+            mark_plugin(table.size() - 1);
+            added.push_back(table.size() - 1);
         }
-        lilv_node_free(nd);
-        const LilvPluginClass* cls = lilv_plugin_get_class(plug);
-        tip = lilv_node_as_string(lilv_plugin_class_get_label(cls));
-        cats.insert(cats.begin(),tip);
-        nd = lilv_plugin_get_author_name(plug);
-        if (!nd) {
-            nd = lilv_plugin_get_project(plug);
+        plugModel->remove_rows(gone);
+        update_status();
+        fill_class_list();
+        // the new rows go in when they belong to the current view
+        if (!query.empty()) {
+            std::vector<uint32_t> matched = added;
+            table.search.filter(query, &matched);
+            text_bits.resize(table.size());
+            for (std::vector<uint32_t>::iterator it = matched.begin(); it != matched.end(); ++it) {
+                text_bits.set(*it, true);
+            }
         }
-        if (nd) {
-            tip += tipby + lilv_node_as_string(nd);
+        update_view();
+        for (std::vector<uint32_t>::iterator it = added.begin(); it != added.end(); ++it) {
+            if (view_bits.test(*it)) plugModel->insert_row(*it);
         }
-        lilv_node_free(nd);
-        fill_tooltip(&tip, plug);
-        row[pinfo.col_tip] = tip;
+        log_timing("bundles reloaded", load_start);
+    }
+    if (bundles_dirty) on_bundles_changed();
+}
+
+// the lists are looked up once per plugin, the views only test bits
+void LV2PluginList::mark_plugin(size_t i) {
+    const std::string uri = table.get(table.uri[i]);
+    fav_bits.resize(i + 1);
+    bl_bits.resize(i + 1);
+    fav_bits.set(i, favs.count(uri));
+    bl_bits.set(i, bls.count(uri));
+    std::unordered_map<std::string, gint64>::iterator it = recent.find(uri);
+    last_used.resize(i + 1);
+    last_used[i] = it != recent.end() ? it->second : 0;
+}
+
+// the tree view stays attached, it only follows the rows which changed
+void LV2PluginList::show_rows(const std::vector<uint32_t>& rows) {
+    plugModel->set_rows(rows);
+}
+
+bool LV2PluginList::on_query_tooltip(int x, int y, bool keyboard_tooltip,
+                                     const Glib::RefPtr<Gtk::Tooltip>& tooltip) {
+    Gtk::TreeModel::iterator iter;
+    if (!treeView.get_tooltip_context_iter(x, y, keyboard_tooltip, iter)) return false;
+    int i = plugModel->get_index(iter);
+    if (i < 0 || (size_t)i >= table.size()) return false;
+    tooltip->set_text(table.get_tooltip(i));
+    treeView.set_tooltip_row(tooltip, plugModel->get_path(iter));
+    return true;
+}
+
+void LV2PluginList::update_status() {
+    valid_plugs = 0;
+    invalid_plugs = 0;
+    Glib::ustring invalid = "";
+    for (std::vector<std::string>::iterator it = table.invalid.begin();
+                                    it != table.invalid.end(); ++it) {
+        if (bls.count(*it)) continue;
+        invalid += "\n";
+        invalid += *it;
+        invalid_plugs++;
+    }
+    for (size_t i = 0; i < table.size(); i++) {
+        if (table.removed.test(i) || is_bl(i)) continue;
+        valid_plugs++;
     }
     tool_tip = to_string(valid_plugs)+_(" valid plugins installed\n");
     tool_tip += to_string(invalid_plugs)+_(" invalid plugins found");
     tool_tip += invalid;
     if (status_icon) status_icon->set_tooltip_text(tool_tip);
-    if (fav.get_active()) on_fav_button();
 }
 
+bool LV2PluginList::filtered() const {
+    return fav.get_active() || bl.get_active() || !query.empty() || !class_filter.empty() ||
+           !port_query.empty();
+}
+
+// candidates looked at per idle call while typing
+#define SEARCH_STEP 2000
+
+// a search narrowing the last one only needs to look at the last result
 void LV2PluginList::refill_list() {
-    Glib::ustring name;
-    Glib::ustring name_search;
-    Glib::ustring tip;
-    Glib::ustring tip1;
-    Glib::ustring tipby = _(" \nby ");
-    LilvNode* nd;
-
-    for (LilvIter* it = lilv_plugins_begin(lv2_plugins);
-      !lilv_plugins_is_end(lv2_plugins, it);
-      it = lilv_plugins_next(lv2_plugins, it)) {
-        const LilvPlugin* plug = lilv_plugins_get(lv2_plugins, it);
-        if (plug) {
-            nd = lilv_plugin_get_name(plug);
-        }
-        if (nd) {
-            name = lilv_node_as_string(nd);
-            const LilvPluginClass* cls = lilv_plugin_get_class(plug);
-            tip = lilv_node_as_string(lilv_plugin_class_get_label(cls));
-            tip1 = lilv_node_as_string(lilv_plugin_get_uri(plug));
-            name_search = name+tip+tip1;
-            truncate_name(&name);
+    // a search running in steps is done here at once
+    search_idle.disconnect();
+    if (!query.empty()) {
+        if (search_size == table.size() && SearchIndex::narrows(query, search_query)) {
+            table.search.filter(query, &search_result);
         } else {
-            continue;
+            table.search.find(query, &search_result);
         }
-        lilv_node_free(nd);
-        Glib::ustring::size_type found = name_search.lowercase().find(regex.lowercase());
-        if (found!=Glib::ustring::npos && !is_bl(lilv_node_as_string(lilv_plugin_get_uri(plug)))){
-            row = *(listStore->append());
-            row[pinfo.col_plug] = plug;
-            row[pinfo.col_id] = lilv_node_as_string(lilv_plugin_get_uri(plug));
-            row[pinfo.col_name] = name;
-            row[pinfo.col_fav] = is_fav(lilv_node_as_string(lilv_plugin_get_uri(plug)));
-            row[pinfo.col_bl] = is_bl(lilv_node_as_string(lilv_plugin_get_uri(plug)));
-            nd = lilv_plugin_get_author_name(plug);
-            if (!nd) {
-                nd = lilv_plugin_get_project(plug);
-            }
-            if (nd) {
-                tip += tipby + lilv_node_as_string(nd);
-            }
+        search_query = query;
+        search_size = table.size();
+        text_bits.assign(table.size(), search_result);
+    }
+    show_view();
+}
 
-            lilv_node_free(nd);
-            fill_tooltip(&tip, plug);
-            row[pinfo.col_tip] = tip;
-        }
+void LV2PluginList::show_view() {
+    update_view();
+    std::vector<uint32_t> rows;
+    view_rows(get_order(), view_bits, &rows);
+    show_rows(rows);
+}
+
+// typing searches in steps from an idle handler, the next keystroke
+// drops a step which hasn't run yet, so a slow pass never holds up input
+bool LV2PluginList::on_search_idle() {
+    if (!search_pass.step(SEARCH_STEP)) return true;
+    search_result.swap(search_pass.result);
+    search_query = query;
+    search_size = search_pass.indexed;
+    text_bits.assign(table.size(), search_result);
+    show_view();
+    return false;
+}
+
+// the table only grows until it is cleared or swapped, both go with
+// clear_orders(), so a sorted order of the current size is up to date
+const std::vector<uint32_t>& LV2PluginList::get_order() {
+    std::vector<uint32_t>& order = orders[sort_order];
+    if (order.size() == table.size()) return order;
+    TraceSpan span("sort");
+    sort_rows(table, last_used, sort_order, &order);
+    return order;
+}
+
+void LV2PluginList::clear_orders() {
+    for (int32_t o = 0; o < SORT_ORDERS; o++) orders[o].clear();
+}
+
+// every filter is a bitset over the table, so any combination of them
+// costs a few word operations per 64 plugins
+void LV2PluginList::update_view() {
+    // the port columns are compact, a scan is cheaper than keeping bitsets
+    if (!port_query.empty()) port_query.apply(table, &port_bits);
+    Bitset none;
+    const Bitset* class_bits = NULL;
+    if (!class_filter.empty()) {
+        int32_t c = class_index.find(class_filter);
+        class_bits = c >= 0 ? &class_index.classes[c].plugins : &none;
     }
+    compose_view(table, fav_bits, bl_bits, fav.get_active(), bl.get_active(),
+                 query.empty() ? NULL : &text_bits,
+                 port_query.empty() ? NULL : &port_bits, class_bits, &view_bits);
 }
 
 void LV2PluginList::new_list() {
     new_world = true;
-    listStore->clear();
-    lilv_world_free(world);
-    world = NULL;
+    search_timeout.disconnect();
     textEntry.get_entry()->set_text("");
-    fill_list();
+    if (filtered()) {
+        query = "";
+        class_filter.clear();
+        port_query.clear();
+        refill_list();
+    }
+    fill_list(true);
+    interpreters.rescan();
+}
+
+// blacklisted plugins are indexed too, the blacklist view may need them,
+// until the world is loaded the classes are only known by the plugins,
+// they show up flat then and get sorted into the tree later
+void LV2PluginList::index_classes() {
+    if (catalog) class_index = catalog->classes;
+    else class_index.clear();
+    class_index.reset(table.size());
+    for (size_t i = 0; i < table.size(); i++) {
+        if (table.removed.test(i)) continue;
+        class_index.add_plugin(i, table.get(table.cls_uri[i]), table.get(table.cls[i]));
+    }
+}
+
+struct ClassLess {
+    const ClassIndex* index;
+    bool operator()(uint32_t a, uint32_t b) const {
+        return index->classes[a].label < index->classes[b].label;
+    }
+};
+
+// one entry per class which has plugins, subclasses indented below
+void LV2PluginList::append_class(uint32_t c, int32_t depth) {
+    const PluginClass& cls = class_index.classes[c];
+    Bitset listed = cls.plugins;
+    listed.and_not(bl_bits);
+    size_t n = listed.count();
+    if (!n) return;
+    Glib::ustring entry = std::string(depth * 2, ' ') + cls.label + " (" + to_string(n) + ")";
+    class_entries[entry] = cls.uri;
+    textEntry.append(entry);
+    std::vector<uint32_t> children = cls.children;
+    ClassLess less = { &class_index };
+    sort(children.begin(), children.end(), less);
+    for (std::vector<uint32_t>::iterator it = children.begin(); it != children.end(); ++it) {
+        append_class(*it, depth + 1);
+    }
 }
 
 void LV2PluginList::fill_class_list() {
-    sort(cats.begin(), cats.end());
-    cats.erase( unique(cats.begin(), cats.end()), cats.end());
-    for (std::vector<Glib::ustring>::iterator it = cats.begin() ; it != cats.end(); ++it)
-        textEntry.append(*it);
+    TraceSpan span("class index");
+    index_classes();
+    // the counts may change, the class in use gets its new entry and
+    // keeps the words typed behind it
+    Glib::ustring text = textEntry.get_entry()->get_text();
+    Glib::ustring rest = text;
+    bool had_class = false;
+    for (std::map<Glib::ustring, std::string>::iterator it = class_entries.begin();
+                                           it != class_entries.end(); ++it) {
+        if (class_filter.empty() || it->second != class_filter) continue;
+        if (text.raw().compare(0, it->first.raw().size(), it->first.raw()) != 0) continue;
+        rest = text.raw().substr(it->first.raw().size());
+        had_class = true;
+        break;
+    }
+    filling_classes = true;
+    textEntry.remove_all();
+    class_entries.clear();
+    std::vector<uint32_t> roots;
+    for (size_t c = 0; c < class_index.size(); c++) {
+        if (class_index.classes[c].parent < 0) roots.push_back(c);
+    }
+    ClassLess less = { &class_index };
+    sort(roots.begin(), roots.end(), less);
+    for (std::vector<uint32_t>::iterator it = roots.begin(); it != roots.end(); ++it) {
+        append_class(*it, 0);
+    }
+    bool found = false;
+    for (std::map<Glib::ustring, std::string>::iterator it = class_entries.begin();
+                                 had_class && it != class_entries.end(); ++it) {
+        if (it->second != class_filter) continue;
+        text = it->first + rest;
+        found = true;
+        break;
+    }
+    if (textEntry.get_entry()->get_text() != text) textEntry.get_entry()->set_text(text);
+    filling_classes = false;
+    // the class is gone, what's left in the entry is a plain search now,
+    // it runs once the caller is done with the current view
+    if (had_class && !found) {
+        search_timeout.disconnect();
+        search_timeout = Glib::signal_timeout().connect(
+          sigc::mem_fun(*this, &LV2PluginList::on_search_timeout), 0);
+    }
 }
 
+// typing restarts the timeout, so a burst of keystrokes runs one search
 void LV2PluginList::on_entry_changed() {
+    if (filling_classes) return;
     if(! new_world) {
-        regex = textEntry.get_entry()->get_text();
-        listStore->clear();
-        refill_list();
-        if (fav.get_active()) on_fav_button();
+        search_idle.disconnect();
+        search_timeout.disconnect();
+        search_timeout = Glib::signal_timeout().connect(
+          sigc::mem_fun(*this, &LV2PluginList::on_search_timeout), 120);
     } else {
         new_world = false;
     }
 }
 
+// an entry of the class combo filters by class, text typed behind it
+// searches within the class, port tokens filter by the port columns
+bool LV2PluginList::on_search_timeout() {
+    Glib::ustring text = textEntry.get_entry()->get_text();
+    class_filter.clear();
+    query = text;
+    for (std::map<Glib::ustring, std::string>::iterator it = class_entries.begin();
+                                           it != class_entries.end(); ++it) {
+        const std::string& entry = it->first.raw();
+        if (text.raw().compare(0, entry.size(), entry) != 0) continue;
+        if (text.raw().size() > entry.size() && text.raw()[entry.size()] != ' ') continue;
+        class_filter = it->second;
+        query = text.raw().substr(std::min(entry.size() + 1, text.raw().size()));
+        break;
+    }
+    std::string rest;
+    port_query.parse(query, &rest);
+    query = rest;
+    TraceSpan span("filter", text);
+    if (query.empty()) {
+        refill_list();
+        return false;
+    }
+    search_idle.disconnect();
+    bool narrow = search_size == table.size() && SearchIndex::narrows(query, search_query);
+    search_pass.start(table.search, query, narrow ? &search_result : NULL);
+    // a short pass is done right away
+    if (on_search_idle()) {
+        search_idle = Glib::signal_idle().connect(
+          sigc::mem_fun(*this, &LV2PluginList::on_search_idle));
+    }
+    return false;
+}
+
 void LV2PluginList::on_combo_changed() {
     pstore.interpret = comboBox.get_active_text();
 }
 
+void LV2PluginList::on_sort_changed() {
+    int32_t o = sortBox.get_active_row_number();
+    if (o < 0 || o >= SORT_ORDERS) return;
+    sort_order = SortOrder(o);
+    plugModel->set_order(sort_order);
+    refill_list();
+}
+
 void LV2PluginList::show_preset_menu() {
     Gtk::TreeModel::iterator iter = selection->get_selected();
     if(iter) {  
         Gtk::TreeModel::Row row = *iter;
-        const LilvPlugin* plug = row[pinfo.col_plug];
-        Glib::ustring id = " " + row[pinfo.col_id] + " & " ;
-        pstore.create_preset_list( id, plug, world);
+        Glib::ustring uri = row[pinfo.col_id];
+        Glib::ustring id = uri;
+        // the presets are still being indexed, there's only the default to offer
+        if (!catalog->presets_complete) {
+            pstore.create_preset_list( id, NULL);
+            return;
+        }
+        pstore.create_preset_list( id, catalog->presets.find(uri));
     }
 }
 
@@ -968,7 +4324,6 @@ void LV2PluginList::copy_to_clipboard() {
     Gtk::TreeModel::iterator iter = selection->get_selected();
     if(iter) {  
         Gtk::TreeModel::Row row = *iter;
-        const LilvPlugin* plug = row[pinfo.col_plug];
         Glib::ustring id = row[pinfo.col_id];
         Glib::RefPtr<Gtk::Clipboard> clipboard = Gtk::Clipboard::get();
         clipboard->set_text(id.c_str());
@@ -1036,6 +4391,15 @@ void LV2PluginList::systray_hide() {
     }
 }
 
+// the window is mapped again, the end of the way from a hotkey press
+bool LV2PluginList::on_window_map(GdkEventAny *ev) {
+    if (!hotkey_start) return false;
+    log_timing("hotkey to present", hotkey_start);
+    if (Trace::is_enabled()) Trace::complete("hotkey to present", hotkey_start);
+    hotkey_start = 0;
+    return false;
+}
+
 void LV2PluginList::come_up() {
     if (get_window()->get_state()
      & (Gdk::WINDOW_STATE_ICONIFIED|Gdk::WINDOW_STATE_WITHDRAWN)) {
@@ -1058,13 +4422,106 @@ void LV2PluginList::go_down() {
     hide();
 }
 
+void LV2PluginList::launch_plugin(const Glib::ustring& uri) {
+    pstore.launcher.launch(pstore.interpret, std::vector<std::string>(1, uri), uri);
+}
+
 void LV2PluginList::on_button_quit() {
     if (fav_changed) save_fav_list();
     if (bl_changed) save_bl_list();
+    if (recent_changed) save_recent_list();
     Gtk::Main::quit();
 }
 
 
+///*** ----------- control socket requests ----------- ***///
+
+// the response starts with "ok" or "error: why" on a line of its own,
+// followed by one line per item, plugins are listed like with --list
+void LV2PluginList::on_control_request(const std::string& request, std::string* response) {
+    TraceSpan span("control", request);
+    std::string line = request;
+    if (!line.empty() && line[line.size() - 1] == '\n') line.erase(line.size() - 1);
+    size_t sp = line.find(' ');
+    std::string cmd = line.substr(0, sp);
+    std::string arg = sp == std::string::npos ? "" : line.substr(sp + 1);
+    std::string body;
+    if (cmd == "list" || cmd == "search") {
+        std::vector<uint32_t> result;
+        find_plugins(table, cmd == "search" ? arg : "", &result);
+        for (std::vector<uint32_t>::iterator it = result.begin(); it != result.end(); ++it) {
+            if (table.removed.test(*it) || is_bl(*it)) continue;
+            body += plugin_tsv(table, *it);
+        }
+    } else if (cmd == "presets") {
+        if (!catalog->presets_complete) {
+            *response = "error: the presets are still being indexed\n";
+            return;
+        }
+        const std::vector<PresetEntry>* presets = catalog->presets.find(arg);
+        if (presets) {
+            for (std::vector<PresetEntry>::const_iterator it = presets->begin();
+                                              it != presets->end(); ++it) {
+                body += it->uri + "\t" + tsv_field(it->label.c_str()) + "\n";
+            }
+        }
+    } else if (cmd == "launch") {
+        // launch URI [PRESET]
+        sp = arg.find(' ');
+        std::string uri = arg.substr(0, sp);
+        // a plugin may be asked for before the list knows it
+        if (list_done && table.find(uri) < 0) {
+            *response = "error: unknown plugin " + uri + "\n";
+            return;
+        }
+        std::vector<std::string> args;
+        if (sp != std::string::npos) {
+            args.push_back("-p");
+            args.push_back(arg.substr(sp + 1));
+        }
+        args.push_back(uri);
+        pid_t pid = pstore.launcher.launch(pstore.interpret, args, uri);
+        if (pid < 0) {
+            *response = "error: can't start " + pstore.interpret + "\n";
+            return;
+        }
+        body = to_string(pid) + "\n";
+    } else if (cmd == "children") {
+        // pid, state, seconds running, command
+        const std::vector<ChildProcess>& children = pstore.launcher.get_children();
+        for (std::vector<ChildProcess>::const_iterator it = children.begin();
+                                          it != children.end(); ++it) {
+            std::string state = "running";
+            if (!it->running && WIFSIGNALED(it->status)) state = "signal " + to_string(WTERMSIG(it->status));
+            else if (!it->running) state = "exit " + to_string(WEXITSTATUS(it->status));
+            gint64 t = it->running ? g_get_real_time() - it->start : it->run_time;
+            char secs[32];
+            snprintf(secs, sizeof(secs), "%.1f", t / 1000000.0);
+            body += to_string(it->pid) + "\t" + state + "\t" + secs + "\t" + it->command + "\n";
+        }
+    } else if (cmd == "stats") {
+        body += "plugins\t" + to_string(valid_plugs) + "\n";
+        body += "invalid\t" + to_string(invalid_plugs) + "\n";
+        body += "shown\t" + to_string(plugModel->size()) + "\n";
+        body += "presets\t" + to_string(catalog->presets_complete ? catalog->presets.size() : 0) + "\n";
+        body += "loading\t" + to_string(loading) + "\n";
+        body += "children\t" + to_string(pstore.launcher.running()) + "\n";
+        body += "clients\t" + to_string(control.client_count()) + "\n";
+    } else if (cmd == "show") {
+        come_up();
+    } else if (cmd == "hide") {
+        go_down();
+    } else if (cmd == "quit") {
+        // the response goes out before the loop ends
+        Glib::signal_idle().connect_once(sigc::mem_fun(*this, &LV2PluginList::on_button_quit));
+    } else {
+        *response = "error: unknown command " + cmd + "\n";
+        return;
+    }
+    *response = "ok\n" + body;
+}
+
+
 ///*** ----------- Class FiFoChannel functions ----------- ***///
 
 FiFoChannel::FiFoChannel() {
@@ -1088,6 +4545,7 @@ bool FiFoChannel::read_fifo(Glib::IOCondition io_condition)
     } else {
         Glib::ustring buf;
         fc->iochannel->read_line(buf);
+        TraceSpan span("fifo", buf);
         if (buf.compare("quit\n") == 0){
             Gtk::Main::quit ();
         } else if (buf.compare("exit\n") == 0) {
@@ -1101,6 +4559,8 @@ bool FiFoChannel::read_fifo(Glib::IOCondition io_condition)
             fc->runner->go_down();
         } else if (buf.compare("systray action\n") == 0) {
             fc->runner->systray_hide();
+        } else if (buf.find("launch ") == 0) {
+            fc->runner->launch_plugin(buf.substr(7, buf.size() - 8));
         } else if (buf.find("PID: ") != Glib::ustring::npos) {
             fc->own_pid +="\n";
             if(buf.compare(fc->own_pid) != 0) {
@@ -1137,8 +4597,12 @@ void FiFoChannel::write_fifo(Glib::IOCondition io_condition, Glib::ustring buf)
     }
 }
 
+std::string FiFoChannel::fifo_path() {
+    return "/tmp/jalv.select.fifo"+to_string(getuid());
+}
+
 int32_t FiFoChannel::open_fifo() {
-    fifo_name = "/tmp/jalv.select.fifo"+to_string(getuid());
+    fifo_name = fifo_path();
     is_mine = false;
     if (access(fifo_name.c_str(), F_OK) == -1) {
         is_mine = true;
@@ -1147,7 +4611,8 @@ int32_t FiFoChannel::open_fifo() {
             return -1;
         }
     }
-    read_fd = open(fifo_name.c_str(), O_RDWR | O_NONBLOCK);
+    // the children must not keep a reader alive once we're gone
+    read_fd = open(fifo_name.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
     if (read_fd == -1) return -1;
     connect_io = Glib::signal_io().connect(
       sigc::ptr_fun(read_fifo), read_fd, Glib::IO_IN);
@@ -1176,21 +4641,38 @@ int32_t main (int32_t argc , char ** argv) {
     bind_textdomain_codeset(GETTEXT_PACKAGE, "UTF-8");
     textdomain(GETTEXT_PACKAGE);
 
+    jalv_select::Options options;
+    try {
+        options.parse(argc, argv);
+    } catch (Glib::OptionError& error) {
+        fprintf(stderr,"%s\n",error.what().c_str()) ;
+    }
+    if (options.catalog_helper) return jalv_select::Catalog::run_helper();
+    if (!options.trace.empty()) jalv_select::Trace::open(options.trace);
+    else if (getenv("JALV_SELECT_TRACE")) jalv_select::Trace::open(getenv("JALV_SELECT_TRACE"));
+    if (options.headless()) return jalv_select::run_headless(options);
+    if (options.version) {
+        options.show_version();
+        return 0;
+    }
+
+    // a running instance is told what to do, this one never gets started
+    std::string msg = "show";
+    if (!options.launch.empty()) msg = "launch " + options.launch;
+    else if (options.hidden) msg = "hide";
+    if (jalv_select::ControlServer::forward(msg)) return 0;
+
+    gint64 start = g_get_monotonic_time();
     Gtk::Main kit (argc, argv);
-    jalv_select::LV2PluginList lv2plugs;
+    if (jalv_select::Trace::is_enabled())
+        jalv_select::Trace::complete("gtk init", start);
+    jalv_select::LV2PluginList lv2plugs(options);
 
     // disable anoing gtk warnings
     g_log_set_handler("Gtk", G_LOG_LEVEL_WARNING, null_handler, NULL);
 
-    try {
-        lv2plugs.options.parse(argc, argv);
-    } catch (Glib::OptionError& error) {
-        fprintf(stderr,"%s\n",error.what().c_str()) ;
-    }
-    
     if(lv2plugs.options.hidden) lv2plugs.hide();
     if(lv2plugs.options.w_high) lv2plugs.resize(1, lv2plugs.options.w_high);
-    if(lv2plugs.options.version) lv2plugs.options.show_version_and_exit(&lv2plugs);
 
     jalv_select::FiFoChannel *fc = jalv_select::FiFoChannel::get_instance();
     fc->own_pid = "PID: ";
@@ -1199,6 +4681,7 @@ int32_t main (int32_t argc , char ** argv) {
     if (!fc->is_mine) {
         fc->write_fifo(Glib::IO_OUT,fc->own_pid);
     }
+    if (!options.launch.empty()) lv2plugs.launch_plugin(options.launch);
 
     Gtk::Main::run();
     return 0;
@@ -35,23 +35,41 @@
 
 #include <fcntl.h>
 #include <fstream>
-
-#include <pthread.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <sstream>
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
 
 #include <unistd.h> 
+#include <spawn.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
 
 #include <libintl.h>
 #include <locale.h>
 
 #include <lilv/lilv.h>
 #include "lv2/lv2plug.in/ns/ext/presets/presets.h"
-#include "lv2/lv2plug.in/ns/ext/state/state.h"
-#include "lv2/lv2plug.in/ns/ext/urid/urid.h"
 #include "lv2/lv2plug.in/ns/ext/atom/atom.h"
 
 #include "config.h"
@@ -60,6 +78,101 @@
 
 namespace jalv_select {
 
+///*** ----------- Class Trace definition ----------- ***///
+
+// collects Chrome trace events ("ph":"X"), written out at exit
+class Trace {
+    static std::atomic<bool> enabled;
+    static std::mutex mutex;
+    static std::string file;
+    static gint64 origin;
+    static std::vector<std::string> events;
+    static void write();
+public:
+    static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+    static void open(const std::string& path);
+    static void complete(const char* name, gint64 start, const char* detail = NULL);
+};
+
+// records one span from construction to destruction when tracing is on
+class TraceSpan {
+    const char* name;
+    std::string detail;
+    gint64 start;
+public:
+    TraceSpan(const char* n, const std::string& d = std::string()) :
+        name(n), detail(d), start(Trace::is_enabled() ? g_get_monotonic_time() : 0) {}
+    ~TraceSpan() {
+        if (start) Trace::complete(name, start, detail.empty() ? NULL : detail.c_str());
+    }
+};
+
+
+///*** ----------- Class Launcher definition ----------- ***///
+
+struct ChildProcess {
+    pid_t pid;
+    std::string uri;
+    std::string command;
+    gint64 start;      // wall clock, microseconds
+    gint64 spawn_time; // launch to exec, microseconds
+    gint64 run_time;
+    int status;        // wait status, only valid once it's no longer running
+    bool running;
+};
+
+// starts the interpreter without a shell and reaps it from the main loop
+class Launcher {
+private:
+    std::vector<ChildProcess> children;
+    void on_child_exit(GPid pid, int status);
+
+public:
+    // called with the plugin URI of every successful launch
+    sigc::slot<void, const std::string&> on_launch;
+
+    pid_t launch(const Glib::ustring& interpret, const std::vector<std::string>& args,
+                 const std::string& uri);
+    const std::vector<ChildProcess>& get_children() const { return children; }
+    size_t running() const;
+
+    Launcher();
+
+    ~Launcher();
+};
+
+
+///*** ----------- Class PresetIndex definition ----------- ***///
+
+struct PresetEntry {
+    std::string uri;
+    std::string label;
+    // the file it was loaded from
+    std::string doc;
+};
+
+// plugin URI -> presets sorted by label
+class PresetIndex {
+private:
+    std::unordered_map<std::string, std::vector<PresetEntry> > presets;
+    void add_plugin(LilvWorld* world, const LilvPlugin* plug,
+                    const LilvNode* pset_Preset, const LilvNode* rdfs_label);
+
+public:
+    void build(LilvWorld* world, const std::atomic<bool>& cancelled);
+    bool build_plugin(LilvWorld* world, const std::string& uri);
+    void update(LilvWorld* world, const std::vector<std::string>& bundle_uris,
+                const std::set<std::string>& changed);
+    const std::vector<PresetEntry>* find(const std::string& uri) const;
+    // for the catalog cache, which keeps every plugin's presets in order
+    const std::unordered_map<std::string, std::vector<PresetEntry> >& entries() const { return presets; }
+    void append(const std::string& uri, const PresetEntry& e) { presets[uri].push_back(e); }
+    size_t size() const { return presets.size(); }
+    void swap(PresetIndex& other) { presets.swap(other.presets); }
+    void clear() { presets.clear(); }
+};
+
+
 ///*** ----------- Class PresetList definition ----------- ***///
 
 class PresetList {
@@ -69,13 +182,11 @@ class PresetList {
         Presets() {
             add(col_label);
             add(col_uri);
-            add(col_plug);
         }
         ~Presets() {}
    
         Gtk::TreeModelColumn<Glib::ustring> col_label;
         Gtk::TreeModelColumn<Glib::ustring> col_uri;
-        Gtk::TreeModelColumn<const LilvPlugin*> col_plug;
        
     };
     Presets psets;
@@ -83,22 +194,17 @@ class PresetList {
     Glib::RefPtr<Gtk::ListStore> presetStore;
     Gtk::TreeModel::Row row ;
     
-    int32_t write_state_to_file(Glib::ustring state);
-    void on_preset_selected(Gtk::Menu *presetMenu, Glib::ustring id, Gtk::TreeModel::iterator iter, LilvWorld* world);
+    void on_preset_selected(Gtk::Menu *presetMenu, Glib::ustring id, Gtk::TreeModel::iterator iter);
     void on_preset_default(Gtk::Menu *presetMenu, Glib::ustring id);
-    void create_preset_menu(Glib::ustring id, LilvWorld* world);
+    void create_preset_menu(Glib::ustring id);
     void on_preset_key(GdkEventKey *ev,Gtk::Menu *presetMenu);
 
-    static char** uris;
-    static off_t n_uris;
-    static const char* unmap_uri(LV2_URID_Map_Handle handle, LV2_URID urid);
-    static LV2_URID map_uri(LV2_URID_Map_Handle handle, const char* uri);
-
     public:
     Glib::ustring interpret;
+    Launcher launcher;
     Glib::RefPtr<Gtk::TreeView::Selection> selection;
 
-    void create_preset_list(Glib::ustring id, const LilvPlugin* plug, LilvWorld* world);
+    void create_preset_list(Glib::ustring id, const std::vector<PresetEntry>* presets);
     
     PresetList();
 
@@ -107,6 +213,523 @@ class PresetList {
 };
 
 
+///*** ----------- Class Bitset definition ----------- ***///
+
+// one bit per plugin table index
+class Bitset {
+private:
+    std::vector<uint64_t> words;
+    size_t bits;
+
+public:
+    bool test(size_t i) const { return i < bits && ((words[i >> 6] >> (i & 63)) & 1); }
+    void set(size_t i, bool value);
+    void resize(size_t n);
+    size_t size() const { return bits; }
+    size_t count() const;
+    void fill();
+    void and_with(const Bitset& other);
+    void and_not(const Bitset& other);
+    void assign(size_t n, const std::vector<uint32_t>& indices);
+    void get_indices(std::vector<uint32_t> *indices) const;
+    void swap(Bitset& other) { words.swap(other.words); std::swap(bits, other.bits); }
+    void clear();
+
+    Bitset();
+
+    ~Bitset();
+};
+
+
+///*** ----------- Class ClassIndex definition ----------- ***///
+
+struct PluginClass {
+    std::string uri;
+    std::string label;
+    int32_t parent;
+    std::vector<uint32_t> children;
+    // the plugins of this class and of all its subclasses
+    Bitset plugins;
+};
+
+// the plugin class tree from the lilv world, classes which aren't in
+// the world show up as top level classes once a plugin uses them
+class ClassIndex {
+private:
+    std::unordered_map<std::string, uint32_t> ids;
+    uint32_t add_class(const std::string& uri, const std::string& label);
+
+public:
+    std::vector<PluginClass> classes;
+
+    void build(LilvWorld* world);
+    int32_t find(const std::string& uri) const;
+    void reset(size_t n);
+    void add_plugin(size_t i, const std::string& uri, const std::string& label);
+    size_t size() const { return classes.size(); }
+    void clear();
+};
+
+
+///*** ----------- Class ViewFilter definition ----------- ***///
+
+// a view is every plugin of the table which is in each required
+// bitset and in none of the excluded ones
+class ViewFilter {
+private:
+    std::vector<const Bitset*> required;
+    std::vector<const Bitset*> excluded;
+
+public:
+    void require(const Bitset& bits) { required.push_back(&bits); }
+    void exclude(const Bitset& bits) { excluded.push_back(&bits); }
+    void apply(size_t n, Bitset *view) const;
+    void clear() { required.clear(); excluded.clear(); }
+};
+
+
+///*** ----------- Class Catalog definition ----------- ***///
+
+struct CatalogBundle {
+    std::string path;
+    int64_t mtime;
+};
+
+struct CatalogRecord {
+    std::string uri;
+    std::string name;
+    std::string cls;
+    std::string cls_uri;
+    std::string author;
+    uint32_t bundle;
+    uint16_t audio_in;
+    uint16_t audio_out;
+    uint16_t midi_in;
+    uint16_t midi_out;
+    uint16_t control_in;
+    uint16_t control_out;
+    uint16_t cv_in;
+    uint16_t cv_out;
+    // space separated URIs of the features the plugin requires
+    std::string required;
+    bool latency;
+    bool hard_rt;
+    bool valid;
+};
+
+class Catalog {
+private:
+    std::string cache_file;
+    uint64_t key;
+    bool cacheable;
+
+    void scan_bundles();
+    bool read_cache(std::vector<CatalogBundle> *cached_bundles,
+                    std::vector<CatalogRecord> *cached_records,
+                    PresetIndex *cached_presets, bool *has_presets);
+    void write_cache();
+    void parse_all();
+    void parse_bundles(const std::vector<uint32_t>& changed);
+    uint32_t shard_count(size_t n) const;
+    bool parse_sharded(const std::vector<uint32_t>& todo, uint32_t n);
+    void add_plugin(const LilvPlugin* plug, uint32_t bundle);
+    void new_nodes();
+    void free_nodes();
+    LilvNode* lv2_AudioPort;
+    LilvNode* lv2_InputPort;
+    LilvNode* lv2_OutputPort;
+    LilvNode* lv2_MidiPort;
+    LilvNode* lv2_AtomPort;
+    LilvNode* lv2_atom_supports;
+    LilvNode* lv2_ControlPort;
+    LilvNode* lv2_CVPort;
+    LilvNode* lv2_hardRTCapable;
+    uint32_t find_bundle(const LilvPlugin* plug,
+                         const std::vector<std::string>& real_paths);
+    void sort_records();
+    size_t published;
+    void publish(uint32_t total);
+
+public:
+    std::vector<CatalogBundle> bundles;
+    std::vector<CatalogRecord> records;
+    LilvWorld* world;
+    bool world_complete;
+    PresetIndex presets;
+    bool presets_complete;
+    ClassIndex classes;
+    bool from_cache;
+    uint32_t parsed_bundles;
+    std::atomic<bool> cancelled;
+    // helper processes parsing the bundles, 0 takes one per core
+    // when there are enough bundles to make up for the start
+    uint32_t jobs;
+    // called from the loading thread with every new batch of records
+    sigc::slot<void, const CatalogRecord*, size_t> on_records;
+    sigc::slot<void, uint32_t, uint32_t> on_progress;
+
+    void load(bool rescan);
+    void clear();
+    LilvWorld* get_world();
+    void index_presets();
+    void index_classes();
+    bool update(std::set<std::string> *changed);
+    void copy_from(Catalog& other);
+
+    static int32_t run_helper();
+
+    Catalog();
+
+    ~Catalog();
+};
+
+
+///*** ----------- Class BundleWatcher definition ----------- ***///
+
+// inotify on the LV2_PATH directories and the bundles in them,
+// on_changed is called from the main loop once the changes settle
+class BundleWatcher {
+private:
+    int32_t fd;
+    std::set<std::string> watched;
+    std::map<int32_t, std::string> watches;
+    sigc::connection io;
+    sigc::connection settle;
+    bool on_io(Glib::IOCondition condition);
+    bool on_settle();
+
+public:
+    sigc::slot<void> on_changed;
+
+    void watch();
+
+    BundleWatcher();
+
+    ~BundleWatcher();
+};
+
+
+///*** ----------- Class ControlServer definition ----------- ***///
+
+struct ControlClient {
+    int32_t fd;
+    std::string in;
+    std::string out;
+    bool eof;
+    int32_t condition;
+    sigc::connection io;
+};
+
+// a unix socket in the user runtime dir, every frame is a 32 bit big endian
+// length and that many bytes, each request frame gets one response frame
+// in order, so a client may send a whole batch before it reads
+class ControlServer {
+private:
+    int32_t fd;
+    std::string path;
+    ino_t inode;
+    std::map<int32_t, ControlClient> clients;
+    sigc::connection accept_io;
+    bool on_accept(Glib::IOCondition condition);
+    bool on_client_io(Glib::IOCondition condition, int32_t client_fd);
+    bool flush_client(ControlClient& client);
+    void watch_client(ControlClient& client);
+    void close_client(int32_t client_fd);
+
+public:
+    sigc::slot<void, const std::string&, std::string*> on_request;
+
+    bool open();
+    size_t client_count() const { return clients.size(); }
+    static std::string socket_path();
+    static bool request(const std::string& req, std::string *response, int32_t timeout_ms);
+    static bool forward(const std::string& msg);
+
+    ControlServer();
+
+    ~ControlServer();
+};
+
+
+///*** ----------- Class Interpreters definition ----------- ***///
+
+// the LV2 hosts found in PATH, cached by the mtimes of the PATH directories
+class Interpreters {
+private:
+    std::string cache_file;
+    uint64_t key;
+    std::thread scan_thread;
+    std::mutex scan_mutex;
+    std::vector<std::string> scanned;
+    bool rescanned;
+    static uint64_t path_key();
+    static bool scan(std::vector<std::string> *found);
+    bool read_cache();
+    void write_cache(uint64_t k, const std::vector<std::string>& found);
+    void run_rescan();
+
+public:
+    std::vector<std::string> names;
+    // emitted when a rescan found a different list
+    Glib::Dispatcher changed;
+
+    void load();
+    void rescan();
+    bool update();
+
+    Interpreters();
+
+    ~Interpreters();
+};
+
+
+///*** ----------- Class SearchIndex definition ----------- ***///
+
+// case and diacritic folded search keys with a trigram posting list,
+// a query with the prefix "re:" is matched as regular expression instead
+class SearchIndex {
+private:
+    std::string keys;
+    std::string texts;
+    std::vector<uint32_t> key;
+    std::vector<uint32_t> text;
+    std::unordered_map<uint32_t, std::vector<uint32_t> > postings;
+    static uint32_t trigram(const char* p);
+
+public:
+    static std::string fold(const std::string& s);
+    static bool is_regex(const Glib::ustring& query);
+    static bool narrows(const Glib::ustring& query, const Glib::ustring& previous);
+    void add(uint32_t id, const std::string& s);
+    void find(const Glib::ustring& query, std::vector<uint32_t> *result) const;
+    void filter(const Glib::ustring& query, std::vector<uint32_t> *result) const;
+    void candidates(const Glib::ustring& query, std::vector<uint32_t> *ids) const;
+    bool match(uint32_t id, const std::string& folded, const Glib::RefPtr<Glib::Regex>& re) const;
+    size_t size() const { return key.size(); }
+    void swap(SearchIndex& other);
+    void clear();
+};
+
+
+///*** ----------- Class SearchPass definition ----------- ***///
+
+// a search over the candidates of a query in steps, so a newer query
+// can drop it between two of them
+class SearchPass {
+private:
+    const SearchIndex* index;
+    std::string folded;
+    Glib::RefPtr<Glib::Regex> re;
+    std::vector<uint32_t> ids;
+    size_t pos;
+
+public:
+    // the index size when the pass started, later ids aren't looked at
+    size_t indexed;
+    std::vector<uint32_t> result;
+
+    void start(const SearchIndex& i, const Glib::ustring& query,
+               const std::vector<uint32_t>* within);
+    bool step(size_t n);
+
+    SearchPass() : index(NULL), pos(0), indexed(0) {}
+};
+
+
+///*** ----------- Class PluginTable definition ----------- ***///
+
+// the plugins of one catalog load, one column per field,
+// strings are offsets into a single pool
+class PluginTable {
+private:
+    std::string pool;
+    std::map<std::string, uint32_t> shared;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::unordered_map<uint32_t, uint32_t> keys;
+    uint32_t add_string(const std::string& s);
+    uint32_t add_shared(const std::string& s);
+    uint32_t add_key(uint32_t off);
+    void truncate_name(std::string *name);
+
+public:
+    std::vector<uint32_t> uri;
+    std::vector<uint32_t> name;
+    std::vector<uint32_t> short_name;
+    // g_utf8_collate_key() of short_name, cls and author
+    std::vector<uint32_t> name_key;
+    std::vector<uint32_t> cls_key;
+    std::vector<uint32_t> author_key;
+    std::vector<uint32_t> cls;
+    std::vector<uint32_t> cls_uri;
+    std::vector<uint32_t> author;
+    std::vector<uint16_t> audio_in;
+    std::vector<uint16_t> audio_out;
+    std::vector<uint16_t> midi_in;
+    std::vector<uint16_t> midi_out;
+    std::vector<uint16_t> control_in;
+    std::vector<uint16_t> control_out;
+    std::vector<uint16_t> cv_in;
+    std::vector<uint16_t> cv_out;
+    std::vector<uint32_t> required;
+    Bitset latency;
+    Bitset hard_rt;
+    std::vector<Glib::ustring> tooltip;
+    std::vector<std::string> invalid;
+    // rows of plugins which are gone or were replaced by a newer row
+    Bitset removed;
+    SearchIndex search;
+
+    const char* get(uint32_t off) const { return pool.data() + off; }
+    const Glib::ustring& get_tooltip(size_t i);
+    size_t size() const { return uri.size(); }
+    bool append(const CatalogRecord& rec);
+    int32_t find(const std::string& u) const;
+    void remove(const std::string& u);
+    void swap(PluginTable& other);
+    void clear();
+
+    PluginTable();
+
+    ~PluginTable();
+};
+
+
+///*** ----------- Class PortQuery definition ----------- ***///
+
+enum PortField {
+    PORT_AUDIO_IN,
+    PORT_AUDIO_OUT,
+    PORT_CONTROL_IN,
+    PORT_CONTROL_OUT,
+    PORT_CV_IN,
+    PORT_CV_OUT,
+    PORT_CV,
+    PORT_MIDI_IN,
+    PORT_MIDI_OUT,
+    PORT_LATENCY,
+    PORT_HARD_RT,
+    PORT_FEATURES,
+    PORT_FEATURE
+};
+
+struct PortTerm {
+    PortField field;
+    uint32_t count;
+    bool at_least;
+    std::string text;
+};
+
+// the port shape tokens of a search, like "ain:2 aout:2+ midi:in rt",
+// they are matched against the port columns of the plugin table
+class PortQuery {
+private:
+    std::vector<PortTerm> terms;
+    static bool parse_token(const std::string& token, PortTerm *term);
+    static uint32_t value(const PluginTable& table, size_t i, const PortTerm& term);
+
+public:
+    void parse(const std::string& text, std::string *rest);
+    void apply(const PluginTable& table, Bitset *result) const;
+    bool empty() const { return terms.empty(); }
+    void clear() { terms.clear(); }
+};
+
+
+///*** ----------- Class PluginModel definition ----------- ***///
+
+class PluginColumns : public Gtk::TreeModel::ColumnRecord {
+public:
+    PluginColumns() {
+        add(col_id);
+        add(col_name);
+        add(col_idx);
+        add(col_fav);
+        add(col_bl);
+    }
+    ~PluginColumns() {}
+
+    Gtk::TreeModelColumn<Glib::ustring> col_id;
+    Gtk::TreeModelColumn<Glib::ustring> col_name;
+    Gtk::TreeModelColumn<int> col_idx;
+    Gtk::TreeModelColumn<bool> col_fav;
+    Gtk::TreeModelColumn<bool> col_bl;
+};
+
+enum SortOrder {
+    SORT_NAME,
+    SORT_CLASS,
+    SORT_AUTHOR,
+    SORT_RECENT,
+    SORT_ORDERS
+};
+
+// compares table rows by the collation keys of the table, ties go by name
+// and then by table index, so every order is total
+struct RowLess {
+    const PluginTable* table;
+    // last launch per table row in seconds, 0 for never
+    const std::vector<gint64>* last_used;
+    SortOrder order;
+    bool operator()(uint32_t a, uint32_t b) const;
+};
+
+// the plugin list as seen by the tree view, a vector of table indices
+// in the sort order, the values are read from the table on demand
+class PluginModel : public Glib::Object, public Gtk::TreeModel {
+private:
+    PluginColumns columns;
+    const PluginTable& table;
+    const Bitset& favs;
+    const Bitset& bls;
+    std::vector<uint32_t> rows;
+    // set_rows() moves the rows through this gap, the model sees the
+    // rows in front of it and behind it
+    size_t gap_at;
+    size_t gap_len;
+    RowLess less;
+    int stamp;
+
+    uint32_t row_at(size_t pos) const { return pos < gap_at ? rows[pos] : rows[pos + gap_len]; }
+
+    bool make_iter(size_t pos, iterator& iter) const;
+    size_t row_pos(const iterator& iter) const;
+
+    PluginModel(const PluginTable& t, const Bitset& f, const Bitset& b,
+                const std::vector<gint64>& u);
+
+protected:
+    Gtk::TreeModelFlags get_flags_vfunc() const;
+    int get_n_columns_vfunc() const;
+    GType get_column_type_vfunc(int index) const;
+    void get_value_vfunc(const iterator& iter, int column, Glib::ValueBase& value) const;
+    bool iter_next_vfunc(const iterator& iter, iterator& iter_next) const;
+    bool iter_children_vfunc(const iterator& parent, iterator& iter) const;
+    bool iter_has_child_vfunc(const iterator& iter) const;
+    int iter_n_children_vfunc(const iterator& iter) const;
+    int iter_n_root_children_vfunc() const;
+    bool iter_nth_child_vfunc(const iterator& parent, int n, iterator& iter) const;
+    bool iter_nth_root_child_vfunc(int n, iterator& iter) const;
+    bool iter_parent_vfunc(const iterator& child, iterator& iter) const;
+    Path get_path_vfunc(const iterator& iter) const;
+    bool get_iter_vfunc(const Path& path, iterator& iter) const;
+
+public:
+    static Glib::RefPtr<PluginModel> create(const PluginTable& t, const Bitset& f, const Bitset& b,
+                                            const std::vector<gint64>& u);
+
+    int32_t get_index(const iterator& iter) const;
+    size_t size() const { return rows.size() - gap_len; }
+    void set_rows(const std::vector<uint32_t>& r);
+    void set_order(SortOrder order) { less.order = order; }
+    void insert_row(uint32_t i);
+    void remove_rows(const std::set<int>& gone);
+    void update_row(const Path& path);
+    void clear();
+
+    ~PluginModel();
+};
+
+
 class LV2PluginList; // forward declaration 
 
 ///*** ----------- Class Options definition ----------- ***///
@@ -116,12 +739,34 @@ class Options : public Glib::OptionContext {
     Glib::OptionEntry opt_hide;
     Glib::OptionEntry opt_size;
     Glib::OptionEntry opt_version;
+    Glib::OptionEntry opt_list;
+    Glib::OptionEntry opt_presets;
+    Glib::OptionEntry opt_filter;
+    Glib::OptionEntry opt_json;
+    Glib::OptionEntry opt_bench;
+    Glib::OptionEntry opt_jobs;
+    Glib::OptionEntry opt_helper;
+    Glib::OptionEntry opt_trace;
+    Glib::OptionEntry opt_launch;
+    Glib::OptionEntry opt_hotkey;
 public:
     bool hidden;
     bool version;
     int32_t w_high;
+    bool list;
+    Glib::ustring presets;
+    Glib::ustring filter;
+    bool json;
+    int32_t bench;
+    int32_t jobs;
+    bool catalog_helper;
+    std::string trace;
+    Glib::ustring launch;
+    Glib::ustring hotkey;
 
-    void show_version_and_exit(LV2PluginList *p);
+    bool headless() const { return list || !presets.empty() || !filter.empty() || bench > 0; }
+
+    void show_version();
 
     Options();
 
@@ -130,21 +775,28 @@ public:
 };
 
 
+///*** ----------- headless mode ----------- ***///
+
+// prints the catalog or the presets of a plugin to stdout, no GTK involved
+int32_t run_headless(Options& options);
+
+
 ///*** ----------- Singleton Class KeyGrabber definition ----------- ***///
 
+// the global hotkey is grabbed on an own X connection, whose events are
+// read from the main loop
 class KeyGrabber {
 private:
     Display* dpy;
-    XEvent ev;
     uint32_t modifiers;
     int32_t keycode;
-    pthread_t m_pthr;
-    bool err;
-    void stop_keygrab_thread();
-    void start_keygrab_thread();
-    void keygrab();
+    sigc::connection io;
+    bool grab_key(uint32_t mods);
+    void ungrab_key();
+    bool on_x_event(Glib::IOCondition condition);
+    void on_hotkey(gint64 pressed);
 
-    static void *run_keygrab_thread(void* p);
+    static bool grab_failed;
     static int32_t my_XErrorHandler(Display * d, XErrorEvent * e);
 
     KeyGrabber();
@@ -153,6 +805,7 @@ private:
 
 public:
     LV2PluginList *runner;
+    bool grab(const Glib::ustring& accel);
     static KeyGrabber *get_instance();
 };
 
@@ -170,6 +823,7 @@ private:
     void re_connect_fifo();
 
     static bool read_fifo(Glib::IOCondition io_condition);
+    static std::string fifo_path();
 
     FiFoChannel();
 
@@ -188,31 +842,18 @@ public:
 
 class LV2PluginList : public Gtk::Window {
 
-    class PlugInfo : public Gtk::TreeModel::ColumnRecord {
-    public:
-        PlugInfo() {
-            add(col_id);
-            add(col_name);
-            add(col_tip);
-            add(col_plug);
-            add(col_fav);
-            add(col_bl);
-        }
-        ~PlugInfo() {}
-   
-        Gtk::TreeModelColumn<Glib::ustring> col_id;
-        Gtk::TreeModelColumn<Glib::ustring> col_name;
-        Gtk::TreeModelColumn<Glib::ustring> col_tip;
-        Gtk::TreeModelColumn<const LilvPlugin*> col_plug;
-        Gtk::TreeModelColumn<bool> col_fav;
-        Gtk::TreeModelColumn<bool> col_bl;
-    };
-    PlugInfo pinfo;
+    PluginColumns pinfo;
 
     Glib::ustring la;
-    std::vector<Glib::ustring> cats;
-    std::vector<Glib::ustring> favs;
-    std::vector<Glib::ustring> bls;
+    std::unordered_set<std::string> favs;
+    std::unordered_set<std::string> bls;
+    Bitset fav_bits;
+    Bitset bl_bits;
+    std::unordered_map<std::string, gint64> recent;
+    std::vector<gint64> last_used;
+    SortOrder sort_order;
+    // the table sorted by each order, empty until an order is first used
+    std::vector<uint32_t> orders[SORT_ORDERS];
     Gtk::VBox topBox;
     Gtk::HBox buttonBox;
     Gtk::ComboBoxText comboBox;
@@ -223,8 +864,8 @@ class LV2PluginList : public Gtk::Window {
     Gtk::ToggleButton lang;
     Gtk::Button newList;
     Gtk::ComboBoxText textEntry;
+    Gtk::ComboBoxText sortBox;
     Gtk::TreeView treeView;
-    Gtk::TreeModel::Row row;
     Gtk::Menu MenuPopup;
     Gtk::MenuItem menuQuit;
     int32_t mainwin_x;
@@ -236,53 +877,129 @@ class LV2PluginList : public Gtk::Window {
     sigc::connection lang_c;
 
     PresetList pstore;
+    Interpreters interpreters;
     GtkIconFactory *factory;
     Glib::ustring tool_tip;
     Glib::RefPtr<Gtk::StatusIcon> status_icon;
-    Glib::RefPtr<Gtk::ListStore> listStore;
+    Glib::RefPtr<PluginModel> plugModel;
     Glib::RefPtr<Gtk::ListStore> favStore;
     Glib::RefPtr<Gtk::TreeView::Selection> selection;
-    Glib::ustring regex;
+    Glib::ustring query;
+    // the URI of the class picked from the combo, the class replaces the query
+    std::string class_filter;
+    ClassIndex class_index;
+    std::map<Glib::ustring, std::string> class_entries;
+    bool filling_classes;
+    Glib::ustring search_query;
+    std::vector<uint32_t> search_result;
+    PortQuery port_query;
+    // the plugins matching query and port_query and the plugins shown
+    Bitset text_bits;
+    Bitset port_bits;
+    Bitset view_bits;
+    size_t search_size;
+    sigc::connection search_timeout;
+    SearchPass search_pass;
+    sigc::connection search_idle;
     bool new_world;
 
-    LilvWorld* world;
-    const LilvPlugins* lv2_plugins;
-    LV2_URID_Map map;
-    LV2_Feature map_feature;
+    // the generation in use and the one being loaded, a generation is
+    // freed once nothing holds a reference to it any more
+    std::shared_ptr<Catalog> catalog;
+    std::shared_ptr<Catalog> loader;
+    PluginTable table;
+    PluginTable next_table;
+    bool refreshing;
+    bool updating;
+    BundleWatcher watcher;
+    ControlServer control;
+    bool bundles_dirty;
+    std::thread load_thread;
+    std::mutex load_mutex;
+    std::vector<CatalogRecord> load_queue;
+    std::vector<CatalogRecord> load_pending;
+    size_t load_pos;
+    // plugin URI -> bundle of the record in the table
+    std::unordered_map<std::string, uint32_t> load_seen;
+    std::set<std::string> load_changed;
+    uint32_t load_count;
+    uint32_t load_total;
+    bool load_done;
+    bool world_done;
+    bool load_updated;
+    bool list_done;
+    bool loading;
+    Glib::Dispatcher load_dispatcher;
+    sigc::connection load_idle;
+    gint64 load_start;
     KeyGrabber *kg;
     FiFoChannel *fc;
 
     void get_interpreter();
+    void fill_interpreter_list();
+    void on_interpreters_changed();
     void select_lang();
-    void fill_list();
+    void fill_list(bool rescan);
+    void stop_loading();
+    void load_catalog(bool rescan);
+    void on_catalog_records(const CatalogRecord* recs, size_t n);
+    void on_catalog_progress(uint32_t count, uint32_t total);
+    void on_load_notify();
+    bool on_load_idle();
+    void finish_loading();
+    void take_world();
+    void swap_generation();
+    void update_catalog(std::shared_ptr<Catalog> base);
+    void finish_update();
+    void on_bundles_changed();
+    void on_control_request(const std::string& request, std::string* response);
+    void mark_plugin(size_t i);
+    void show_rows(const std::vector<uint32_t>& rows);
+    void update_status();
+    bool on_query_tooltip(int x, int y, bool keyboard_tooltip,
+                          const Glib::RefPtr<Gtk::Tooltip>& tooltip);
     void refill_list();
+    void show_view();
+    void update_view();
+    bool filtered() const;
+    const std::vector<uint32_t>& get_order();
+    void clear_orders();
+    bool on_search_timeout();
+    bool on_search_idle();
     void new_list();
+    void index_classes();
     void fill_class_list();
+    void append_class(uint32_t c, int32_t depth);
     void systray_menu(guint button, guint32 activate_time);
     void show_preset_menu();
     void copy_to_clipboard();
     void take_focus();
     void button_release_event(GdkEventButton *ev);
     bool key_release_event(GdkEventKey *ev);
+    bool on_window_map(GdkEventAny *ev);
     void on_fav_toggle(Glib::ustring path);
     void read_fav_list();
-    bool is_fav(Glib::ustring id);
+    bool is_fav(size_t i) const { return fav_bits.test(i); }
     bool fav_changed;
     void save_fav_list();
     Glib::ustring config_file;
     Glib::ustring sys_config_file;
     void on_bl_toggle(Glib::ustring path);
     void read_bl_list();
-    bool is_bl(Glib::ustring id);
+    bool is_bl(size_t i) const { return bl_bits.test(i); }
     bool bl_changed;
     void save_bl_list();
     Glib::ustring backlist_file;
     Glib::ustring sys_backlist_file;
+    void on_plugin_launched(const std::string& uri);
+    void read_recent_list();
+    bool recent_changed;
+    void save_recent_list();
+    Glib::ustring recent_file;
 
-    inline void fill_tooltip(Glib::ustring *tip, const LilvPlugin* plug);
-    inline void truncate_name(Glib::ustring *name);
 
     virtual void on_combo_changed();
+    virtual void on_sort_changed();
     virtual void on_entry_changed();
     virtual void on_fav_button();
     virtual void on_bl_button();
@@ -290,12 +1007,15 @@ class LV2PluginList : public Gtk::Window {
     virtual void on_button_quit();
 
 public:
-    Options options;
+    Options& options;
+    // when the hotkey asked for the window, 0 once it's shown
+    gint64 hotkey_start;
     void systray_hide();
     void come_up();
     void go_down();
+    void launch_plugin(const Glib::ustring& uri);
 
-    LV2PluginList();
+    LV2PluginList(Options& o);
 
     ~LV2PluginList();
 